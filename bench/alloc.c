@@ -0,0 +1,56 @@
+#include "alloc.h"
+
+#include <stdlib.h>
+
+/*
+ * The allocation functions are replaced through ELF symbol interposition, glibc
+ * routes its own internal allocations (e.g. asprintf) through them as well.
+ * The counters are plain integers, benchmarks run on a single thread.
+ */
+
+static struct alloc_stats stats;
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+extern void *malloc(size_t size) {
+	stats.allocations++;
+	stats.bytes += size;
+	return __libc_malloc(size);
+}
+
+extern void *calloc(size_t nmemb, size_t size) {
+	stats.allocations++;
+	stats.bytes += nmemb * size;
+	return __libc_calloc(nmemb, size);
+}
+
+extern void *realloc(void *ptr, size_t size) {
+	stats.allocations++;
+	stats.bytes += size;
+	return __libc_realloc(ptr, size);
+}
+
+extern void free(void *ptr) {
+	__libc_free(ptr);
+}
+
+extern bool alloc_counter_is_available(void) {
+	return true;
+}
+
+#else
+
+extern bool alloc_counter_is_available(void) {
+	return false;
+}
+
+#endif
+
+extern struct alloc_stats alloc_counter_read(void) {
+	return stats;
+}
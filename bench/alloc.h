@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+
+struct alloc_stats {
+	size_t allocations; /* calls to malloc, calloc and realloc */
+	size_t bytes;       /* bytes requested by those calls */
+};
+
+/**
+ * @brief Return true if the allocation functions are interposed and the
+ * counters are meaningful on this platform.
+ */
+extern bool alloc_counter_is_available(void);
+
+/**
+ * @brief Read the allocation counters accumulated since the program started.
+ */
+extern struct alloc_stats alloc_counter_read(void);
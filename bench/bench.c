@@ -0,0 +1,538 @@
+#include <buracchi/argparser/argparser.h>
+
+#ifdef HAVE_GETOPT_LONG
+#include <getopt.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+
+/* Every short flag but h, which is taken by the help option. */
+#define SHORT_FLAGS "abcdefgijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define SHORT_FLAGS_NUMBER (sizeof SHORT_FLAGS - 1)
+
+enum workload_kind {
+	WORKLOAD_LONG,
+	WORKLOAD_SHORT,
+	WORKLOAD_POSITIONAL,
+	WORKLOAD_NUMERIC,
+};
+
+struct workload {
+	enum workload_kind kind;
+	size_t options_number;
+	size_t subcommands_number;
+	char **keys;  /* long flags, short flags or positional names */
+	char **flags; /* keys with their leading dashes */
+	char **values;
+	int *numbers;
+	char **subcommand_names;
+	const char *selection;
+	char *subcommand_value;
+	size_t argc; /* argv[0] is the program name, as getopt_long expects */
+	const char **argv;
+	argparser_t parser;
+#ifdef HAVE_GETOPT_LONG
+	struct option *long_options;
+	char *short_options;
+#endif
+};
+
+struct benchmark {
+	const char *name;
+	void (*prepare)(struct workload *workload);  /* once, untimed */
+	void (*setup)(struct workload *workload);    /* each iteration, untimed */
+	void (*run)(struct workload *workload);      /* each iteration, timed */
+	void (*teardown)(struct workload *workload); /* each iteration, untimed */
+	void (*cleanup)(struct workload *workload);  /* once, untimed */
+};
+
+struct measure {
+	size_t iterations;
+	double ns;
+	double allocations;
+	double bytes;
+};
+
+static void workload_init(struct workload *workload,
+                          enum workload_kind kind,
+                          size_t options_number,
+                          size_t subcommands_number,
+                          size_t max_tokens);
+static void workload_destroy(struct workload *workload);
+static void register_arguments(struct workload *workload);
+
+static void create_parser(struct workload *workload);
+static void destroy_parser(struct workload *workload);
+static void run_init(struct workload *workload);
+static void run_registration(struct workload *workload);
+static void run_parse(struct workload *workload);
+static void run_usage(struct workload *workload);
+static void run_help(struct workload *workload);
+#ifdef HAVE_GETOPT_LONG
+static void prepare_getopt_long(struct workload *workload);
+static void run_getopt_long(struct workload *workload);
+static void cleanup_getopt_long(struct workload *workload);
+#endif
+
+static struct measure measure(const struct benchmark *benchmark,
+                              struct workload *workload,
+                              double min_time_ns);
+static void report(const struct benchmark *benchmark,
+                   const struct workload *workload,
+                   const struct measure *measure);
+static double now_ns(void);
+static void *xmalloc(size_t size);
+
+static const char *program_argv[] = { "argparser_bench", nullptr };
+
+static const char *kind_names[] = {
+	[WORKLOAD_LONG] = "long",
+	[WORKLOAD_SHORT] = "short",
+	[WORKLOAD_POSITIONAL] = "positional",
+	[WORKLOAD_NUMERIC] = "numeric",
+};
+
+static const struct benchmark benchmark_init = {
+	.name = "init",
+	.run = run_init,
+	.teardown = destroy_parser,
+};
+
+static const struct benchmark benchmark_registration = {
+	.name = "registration",
+	.setup = run_init,
+	.run = run_registration,
+	.teardown = destroy_parser,
+};
+
+static const struct benchmark benchmark_parse = {
+	.name = "parse",
+	.prepare = create_parser,
+	.run = run_parse,
+	.cleanup = destroy_parser,
+};
+
+static const struct benchmark benchmark_usage = {
+	.name = "usage",
+	.prepare = create_parser,
+	.run = run_usage,
+	.cleanup = destroy_parser,
+};
+
+static const struct benchmark benchmark_help = {
+	.name = "help",
+	.prepare = create_parser,
+	.run = run_help,
+	.cleanup = destroy_parser,
+};
+
+#ifdef HAVE_GETOPT_LONG
+static const struct benchmark benchmark_getopt_long = {
+	.name = "getopt_long",
+	.prepare = prepare_getopt_long,
+	.run = run_getopt_long,
+	.cleanup = cleanup_getopt_long,
+};
+#else
+// Without getopt_long the baseline has nothing to run and is skipped.
+static const struct benchmark benchmark_getopt_long = {
+	.name = "getopt_long",
+};
+#endif
+
+int main(int argc, const char *argv[]) {
+	static const size_t options_sizes[] = { 10, 100, 1000, 10000 };
+	static const size_t subcommands_sizes[] = { 0, 10, 100, 1000 };
+	static const enum workload_kind parse_kinds[] = {
+		WORKLOAD_LONG,
+		WORKLOAD_SHORT,
+		WORKLOAD_POSITIONAL,
+		WORKLOAD_NUMERIC,
+	};
+	unsigned int max_options = 10000;
+	unsigned int max_subcommands = 1000;
+	unsigned int max_tokens = 1000000;
+	unsigned int min_time_ms = 100;
+	char *filter = nullptr;
+	double min_time_ns;
+	struct workload workload;
+	struct measure result;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_set_description(argparser, "Measure the cost of each argparser phase.");
+	argparser_add_argument(argparser,
+	                       &max_options,
+	                       { .long_flag = "max-options",
+	                         .help = "largest number of options (default: 10000)" });
+	argparser_add_argument(argparser,
+	                       &max_subcommands,
+	                       { .long_flag = "max-subcommands",
+	                         .help = "largest number of subcommands (default: 1000)" });
+	argparser_add_argument(argparser,
+	                       &max_tokens,
+	                       { .long_flag = "max-tokens",
+	                         .help = "largest argv length (default: 1000000)" });
+	argparser_add_argument(argparser,
+	                       &min_time_ms,
+	                       { .long_flag = "min-time",
+	                         .help = "minimum measured time per case in ms (default: 100)" });
+	argparser_add_argument(argparser,
+	                       &filter,
+	                       { .long_flag = "filter",
+	                         .help = "only run the benchmarks whose name contains this string" });
+	argparser_parse_args(argparser);
+	min_time_ns = min_time_ms * 1e6;
+	printf("%-14s %-10s %8s %8s %8s %14s %12s %14s\n",
+	       "benchmark",
+	       "argv",
+	       "options",
+	       "subcmds",
+	       "tokens",
+	       "ns/op",
+	       "allocs/op",
+	       "bytes/op");
+	if (!filter || strstr(benchmark_init.name, filter)) {
+		workload_init(&workload, WORKLOAD_LONG, 0, 0, 0);
+		result = measure(&benchmark_init, &workload, min_time_ns);
+		report(&benchmark_init, &workload, &result);
+		workload_destroy(&workload);
+	}
+	for (size_t i = 0; i < sizeof options_sizes / sizeof *options_sizes; i++) {
+		for (size_t j = 0; j < sizeof subcommands_sizes / sizeof *subcommands_sizes; j++) {
+			const struct benchmark *benchmarks[] = {
+				&benchmark_registration,
+				&benchmark_parse,
+				&benchmark_usage,
+				&benchmark_help,
+			};
+			if (options_sizes[i] > max_options || subcommands_sizes[j] > max_subcommands) {
+				continue;
+			}
+			workload_init(&workload, WORKLOAD_LONG, options_sizes[i], subcommands_sizes[j], max_tokens);
+			for (size_t k = 0; k < sizeof benchmarks / sizeof *benchmarks; k++) {
+				if (filter && !strstr(benchmarks[k]->name, filter)) {
+					continue;
+				}
+				result = measure(benchmarks[k], &workload, min_time_ns);
+				report(benchmarks[k], &workload, &result);
+			}
+			workload_destroy(&workload);
+		}
+	}
+	for (size_t i = 0; i < sizeof parse_kinds / sizeof *parse_kinds; i++) {
+		size_t previous_options_number = 0;
+		for (size_t j = 0; j < sizeof options_sizes / sizeof *options_sizes; j++) {
+			const struct benchmark *benchmarks[] = {
+				&benchmark_parse,
+				&benchmark_getopt_long,
+			};
+			if (options_sizes[j] > max_options) {
+				continue;
+			}
+			workload_init(&workload, parse_kinds[i], options_sizes[j], 0, max_tokens);
+			// Short flags saturate early, skip the repeated sizes.
+			if (workload.options_number == previous_options_number) {
+				workload_destroy(&workload);
+				continue;
+			}
+			previous_options_number = workload.options_number;
+			for (size_t k = 0; k < sizeof benchmarks / sizeof *benchmarks; k++) {
+				if ((filter && !strstr(benchmarks[k]->name, filter)) || !benchmarks[k]->run ||
+				    (benchmarks[k] == &benchmark_getopt_long &&
+				     parse_kinds[i] == WORKLOAD_POSITIONAL) ||
+				    (benchmarks[k] == &benchmark_parse && parse_kinds[i] == WORKLOAD_LONG)) {
+					continue;
+				}
+				result = measure(benchmarks[k], &workload, min_time_ns);
+				report(benchmarks[k], &workload, &result);
+			}
+			workload_destroy(&workload);
+		}
+	}
+	argparser_destroy(argparser);
+	return EXIT_SUCCESS;
+}
+
+/*
+ * Build the names and the argv of a synthetic program. Options are given
+ * round-robin until max_tokens is reached, positionals exactly once.
+ */
+static void workload_init(struct workload *workload,
+                          enum workload_kind kind,
+                          size_t options_number,
+                          size_t subcommands_number,
+                          size_t max_tokens) {
+	size_t tokens_per_option = (kind == WORKLOAD_POSITIONAL) ? 1 : 2;
+	size_t max_argc;
+	*workload = (struct workload){
+		.kind = kind,
+		.options_number = options_number,
+		.subcommands_number = subcommands_number,
+	};
+	if (kind == WORKLOAD_SHORT && options_number > SHORT_FLAGS_NUMBER) {
+		workload->options_number = SHORT_FLAGS_NUMBER;
+	}
+	if (kind == WORKLOAD_POSITIONAL && options_number > max_tokens) {
+		workload->options_number = max_tokens; // Positionals are all required.
+	}
+	workload->keys = xmalloc(workload->options_number * sizeof *workload->keys);
+	workload->flags = xmalloc(workload->options_number * sizeof *workload->flags);
+	workload->values = xmalloc(workload->options_number * sizeof *workload->values);
+	workload->numbers = xmalloc(workload->options_number * sizeof *workload->numbers);
+	workload->subcommand_names = xmalloc(subcommands_number * sizeof *workload->subcommand_names);
+	for (size_t i = 0; i < workload->options_number; i++) {
+		switch (kind) {
+		case WORKLOAD_SHORT:
+			workload->keys[i] = xmalloc(2);
+			workload->keys[i][0] = SHORT_FLAGS[i];
+			workload->keys[i][1] = '\0';
+			workload->flags[i] = xmalloc(3);
+			snprintf(workload->flags[i], 3, "-%s", workload->keys[i]);
+			break;
+		case WORKLOAD_POSITIONAL:
+			workload->keys[i] = xmalloc(32);
+			snprintf(workload->keys[i], 32, "positional-%zu", i);
+			workload->flags[i] = nullptr;
+			break;
+		default:
+			workload->keys[i] = xmalloc(32);
+			snprintf(workload->keys[i], 32, "option-%zu", i);
+			workload->flags[i] = xmalloc(40);
+			snprintf(workload->flags[i], 40, "--%s", workload->keys[i]);
+			break;
+		}
+	}
+	for (size_t i = 0; i < subcommands_number; i++) {
+		workload->subcommand_names[i] = xmalloc(32);
+		snprintf(workload->subcommand_names[i], 32, "command-%zu", i);
+	}
+	max_argc = 1 + ((kind == WORKLOAD_POSITIONAL) ? workload->options_number : max_tokens) +
+	           (subcommands_number ? 3 : 0);
+	workload->argv = xmalloc((max_argc + 1) * sizeof *workload->argv);
+	workload->argv[workload->argc++] = program_argv[0];
+	for (size_t i = 0; workload->options_number; i = (i + 1) % workload->options_number) {
+		if (workload->argc - 1 + tokens_per_option > max_tokens ||
+		    (kind == WORKLOAD_POSITIONAL && workload->argc > workload->options_number)) {
+			break;
+		}
+		if (workload->flags[i]) {
+			workload->argv[workload->argc++] = workload->flags[i];
+		}
+		workload->argv[workload->argc++] = (kind == WORKLOAD_NUMERIC) ? "1234567" : "value";
+	}
+	if (subcommands_number) {
+		workload->argv[workload->argc++] = workload->subcommand_names[subcommands_number - 1];
+		workload->argv[workload->argc++] = "--sub-option";
+		workload->argv[workload->argc++] = "value";
+	}
+	workload->argv[workload->argc] = nullptr;
+}
+
+static void workload_destroy(struct workload *workload) {
+	for (size_t i = 0; i < workload->options_number; i++) {
+		free(workload->keys[i]);
+		free(workload->flags[i]);
+	}
+	for (size_t i = 0; i < workload->subcommands_number; i++) {
+		free(workload->subcommand_names[i]);
+	}
+	free(workload->argv);
+	free(workload->subcommand_names);
+	free(workload->numbers);
+	free(workload->values);
+	free(workload->flags);
+	free(workload->keys);
+}
+
+static void register_arguments(struct workload *workload) {
+	argparser_t parser = workload->parser;
+	for (size_t i = 0; i < workload->options_number; i++) {
+		switch (workload->kind) {
+		case WORKLOAD_LONG:
+			argparser_add_argument(parser, &workload->values[i], { .long_flag = workload->keys[i] });
+			break;
+		case WORKLOAD_SHORT:
+			argparser_add_argument(parser, &workload->values[i], { .flag = workload->keys[i] });
+			break;
+		case WORKLOAD_POSITIONAL:
+			argparser_add_argument(parser, &workload->values[i], { .name = workload->keys[i] });
+			break;
+		case WORKLOAD_NUMERIC:
+			argparser_add_argument(parser, &workload->numbers[i], { .long_flag = workload->keys[i] });
+			break;
+		}
+	}
+	for (size_t i = 0; i < workload->subcommands_number; i++) {
+		argparser_t subparser;
+		subparser = argparser_add_subparser(parser,
+		                                    &workload->selection,
+		                                    workload->subcommand_names[i],
+		                                    nullptr);
+		argparser_add_argument(subparser, &workload->subcommand_value, { .long_flag = "sub-option" });
+	}
+}
+
+static void create_parser(struct workload *workload) {
+	run_init(workload);
+	register_arguments(workload);
+}
+
+static void destroy_parser(struct workload *workload) {
+	argparser_destroy(workload->parser);
+	workload->parser = nullptr;
+}
+
+static void run_init(struct workload *workload) {
+	workload->parser = argparser_init(1, program_argv);
+}
+
+static void run_registration(struct workload *workload) {
+	register_arguments(workload);
+}
+
+static void run_parse(struct workload *workload) {
+	argparser_parse_args(workload->parser, workload->argv + 1, workload->argc - 1);
+}
+
+static void run_usage(struct workload *workload) {
+	free(argparser_format_usage(workload->parser));
+}
+
+static void run_help(struct workload *workload) {
+	free(argparser_format_help(workload->parser));
+}
+
+#ifdef HAVE_GETOPT_LONG
+static void prepare_getopt_long(struct workload *workload) {
+	workload->long_options = xmalloc((workload->options_number + 1) * sizeof *workload->long_options);
+	workload->short_options = xmalloc(2 * workload->options_number + 2);
+	workload->short_options[0] = ':';
+	for (size_t i = 0; i < workload->options_number; i++) {
+		workload->long_options[i] = (struct option){
+			.name = workload->keys[i],
+			.has_arg = required_argument,
+		};
+		workload->short_options[2 * i + 1] = workload->keys[i][0];
+		workload->short_options[2 * i + 2] = ':';
+	}
+	workload->long_options[workload->options_number] = (struct option){ 0 };
+	workload->short_options[workload->kind == WORKLOAD_SHORT ? 2 * workload->options_number + 1 : 1] =
+		'\0';
+}
+
+static void run_getopt_long(struct workload *workload) {
+	int option;
+	int long_index;
+	opterr = 0;
+	optind = 0;
+	while ((option = getopt_long((int)workload->argc,
+	                             (char *const *)workload->argv,
+	                             workload->short_options,
+	                             workload->long_options,
+	                             &long_index)) != -1) {
+		if (option == 0) {
+			if (workload->kind == WORKLOAD_NUMERIC) {
+				workload->numbers[long_index] = (int)strtol(optarg, nullptr, 10);
+			}
+			else {
+				workload->values[long_index] = optarg;
+			}
+		}
+		else if (option != '?' && option != ':') {
+			workload->values[strchr(SHORT_FLAGS, option) - SHORT_FLAGS] = optarg;
+		}
+	}
+}
+
+static void cleanup_getopt_long(struct workload *workload) {
+	free(workload->long_options);
+	free(workload->short_options);
+}
+#endif
+
+/*
+ * Run the benchmark doubling the number of iterations until the timed part
+ * takes at least min_time_ns, slow cases run a single iteration.
+ */
+static struct measure measure(const struct benchmark *benchmark,
+                              struct workload *workload,
+                              double min_time_ns) {
+	struct measure result = { 0 };
+	if (benchmark->prepare) {
+		benchmark->prepare(workload);
+	}
+	for (size_t iterations = 1;; iterations *= 2) {
+		double elapsed = 0;
+		size_t allocations = 0;
+		size_t bytes = 0;
+		for (size_t i = 0; i < iterations; i++) {
+			struct alloc_stats before;
+			struct alloc_stats after;
+			double start;
+			if (benchmark->setup) {
+				benchmark->setup(workload);
+			}
+			before = alloc_counter_read();
+			start = now_ns();
+			benchmark->run(workload);
+			elapsed += now_ns() - start;
+			after = alloc_counter_read();
+			allocations += after.allocations - before.allocations;
+			bytes += after.bytes - before.bytes;
+			if (benchmark->teardown) {
+				benchmark->teardown(workload);
+			}
+		}
+		if (elapsed >= min_time_ns || iterations >= (1u << 30)) {
+			result = (struct measure){
+				.iterations = iterations,
+				.ns = elapsed / iterations,
+				.allocations = (double)allocations / iterations,
+				.bytes = (double)bytes / iterations,
+			};
+			break;
+		}
+	}
+	if (benchmark->cleanup) {
+		benchmark->cleanup(workload);
+	}
+	return result;
+}
+
+static void report(const struct benchmark *benchmark,
+                   const struct workload *workload,
+                   const struct measure *measure) {
+	printf("%-14s %-10s %8zu %8zu %8zu %14.1f ",
+	       benchmark->name,
+	       kind_names[workload->kind],
+	       workload->options_number,
+	       workload->subcommands_number,
+	       workload->argc - 1,
+	       measure->ns);
+	if (alloc_counter_is_available()) {
+		printf("%12.1f %14.1f\n", measure->allocations, measure->bytes);
+	}
+	else {
+		printf("%12s %14s\n", "-", "-");
+	}
+	fflush(stdout);
+}
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *xmalloc(size_t size) {
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == nullptr) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
@@ -0,0 +1,263 @@
+#include <buracchi/argparser/argparser.h>
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Cold start harness, every sample tool is executed --runs times and each run
+ * is measured from exec to exit: the counters are attached to the child before
+ * it execs and are enabled by the exec itself.
+ */
+
+#ifndef ARGPARSER_COLDSTART_TOOLS
+#define ARGPARSER_COLDSTART_TOOLS ""
+#endif
+
+/* The arguments given to every tool, the baseline ignores them. */
+static const char *tool_arguments[] = { "--option-0", "value", "--option-5", "value" };
+
+enum metric {
+	METRIC_WALL_NS,
+	METRIC_INSTRUCTIONS,
+	METRIC_PAGE_FAULTS,
+	METRIC_MAX_RSS,
+	METRIC_ALLOCATIONS,
+	METRIC_BYTES,
+	METRICS_NUMBER,
+};
+
+struct sample {
+	double values[METRICS_NUMBER];
+};
+
+static int run_tool(const char *path, struct sample *sample);
+static int open_counter(pid_t pid, uint32_t type, uint64_t config);
+static double read_counter(int fd);
+static double median(struct sample *samples, size_t samples_number, enum metric metric);
+static int compare_doubles(const void *a, const void *b);
+static double now_ns(void);
+
+int main(int argc, const char *argv[]) {
+	unsigned int runs = 100;
+	char *filter = nullptr;
+	char *tools;
+	struct sample *samples;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_set_description(argparser, "Measure the startup cost of sample tools.");
+	argparser_add_argument(argparser,
+	                       &runs,
+	                       { .long_flag = "runs", .help = "executions per tool (default: 100)" });
+	argparser_add_argument(argparser,
+	                       &filter,
+	                       { .long_flag = "filter",
+	                         .help = "only run the tools whose name contains this string" });
+	argparser_parse_args(argparser);
+	if (runs == 0 || (samples = malloc(runs * sizeof *samples)) == nullptr) {
+		argparser_destroy(argparser);
+		return EXIT_FAILURE;
+	}
+	printf("%-16s %12s %12s %14s %12s %12s %10s %12s\n",
+	       "tool",
+	       "wall ns",
+	       "min wall ns",
+	       "instructions",
+	       "page faults",
+	       "max rss KiB",
+	       "allocs",
+	       "bytes");
+	tools = strdup(ARGPARSER_COLDSTART_TOOLS);
+	for (char *save, *tool = strtok_r(tools, ",", &save); tool; tool = strtok_r(nullptr, ",", &save)) {
+		char *path = strchr(tool, '=');
+		double min_wall_ns;
+		if (path == nullptr) {
+			continue;
+		}
+		*path++ = '\0';
+		if (filter && !strstr(tool, filter)) {
+			continue;
+		}
+		run_tool(path, &samples[0]); // Warm up the page cache.
+		for (size_t i = 0; i < runs; i++) {
+			if (run_tool(path, &samples[i])) {
+				fprintf(stderr, "%s: cannot run %s\n", argparser_get_program_name(argparser), path);
+				free(tools);
+				free(samples);
+				argparser_destroy(argparser);
+				return EXIT_FAILURE;
+			}
+		}
+		min_wall_ns = samples[0].values[METRIC_WALL_NS];
+		for (size_t i = 1; i < runs; i++) {
+			if (samples[i].values[METRIC_WALL_NS] < min_wall_ns) {
+				min_wall_ns = samples[i].values[METRIC_WALL_NS];
+			}
+		}
+		printf("%-16s %12.0f %12.0f ", tool, median(samples, runs, METRIC_WALL_NS), min_wall_ns);
+		if (samples[0].values[METRIC_INSTRUCTIONS] < 0) {
+			printf("%14s ", "-");
+		}
+		else {
+			printf("%14.0f ", median(samples, runs, METRIC_INSTRUCTIONS));
+		}
+		printf("%12.0f %12.0f %10.0f %12.0f\n",
+		       median(samples, runs, METRIC_PAGE_FAULTS),
+		       median(samples, runs, METRIC_MAX_RSS),
+		       median(samples, runs, METRIC_ALLOCATIONS),
+		       median(samples, runs, METRIC_BYTES));
+		fflush(stdout);
+	}
+	free(tools);
+	free(samples);
+	argparser_destroy(argparser);
+	return EXIT_SUCCESS;
+}
+
+/*
+ * The child blocks on a pipe until the counters are attached, then execs the
+ * tool. Instructions come from perf_event_open when the kernel allows it (-1
+ * otherwise), page faults and the peak RSS come from the rusage of the child
+ * and the allocation counters are written by the tool on a second pipe.
+ */
+static int run_tool(const char *path, struct sample *sample) {
+	int go[2];
+	int report[2];
+	int instructions_fd;
+	int status;
+	char buffer[64] = { 0 };
+	size_t length = 0;
+	ssize_t bytes_read;
+	struct rusage usage;
+	double start;
+	double end;
+	pid_t pid;
+	if (pipe(go) == -1) {
+		return 1;
+	}
+	fcntl(go[0], F_SETFD, FD_CLOEXEC);
+	fcntl(go[1], F_SETFD, FD_CLOEXEC);
+	if (pipe(report) == -1) {
+		close(go[0]);
+		close(go[1]);
+		return 1;
+	}
+	pid = fork();
+	if (pid == -1) {
+		close(go[0]);
+		close(go[1]);
+		close(report[0]);
+		close(report[1]);
+		return 1;
+	}
+	if (pid == 0) {
+		const char *argv[2 + sizeof tool_arguments / sizeof *tool_arguments] = { path };
+		char fd[16];
+		char c;
+		int null_fd = open("/dev/null", O_WRONLY);
+		memcpy(argv + 1, tool_arguments, sizeof tool_arguments);
+		dup2(null_fd, STDOUT_FILENO);
+		close(report[0]);
+		snprintf(fd, sizeof fd, "%d", report[1]);
+		setenv("ARGPARSER_COLDSTART_FD", fd, 1);
+		close(go[1]);
+		if (read(go[0], &c, 1) != 1) {
+			_exit(EXIT_FAILURE);
+		}
+		execv(path, (char *const *)argv);
+		_exit(127);
+	}
+	close(go[0]);
+	close(report[1]);
+	instructions_fd = open_counter(pid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	start = now_ns();
+	if (write(go[1], "", 1) != 1) {
+		kill(pid, SIGKILL);
+	}
+	close(go[1]);
+	while ((bytes_read = read(report[0], buffer + length, sizeof buffer - 1 - length)) > 0) {
+		length += bytes_read;
+	}
+	close(report[0]);
+	wait4(pid, &status, 0, &usage);
+	end = now_ns();
+	*sample = (struct sample){
+		.values = {
+			[METRIC_WALL_NS] = end - start,
+			[METRIC_INSTRUCTIONS] = read_counter(instructions_fd),
+			[METRIC_PAGE_FAULTS] = usage.ru_minflt + usage.ru_majflt,
+			[METRIC_MAX_RSS] = usage.ru_maxrss,
+		},
+	};
+	if (instructions_fd != -1) {
+		close(instructions_fd);
+	}
+	sscanf(buffer,
+	       "%lf %lf",
+	       &sample->values[METRIC_ALLOCATIONS],
+	       &sample->values[METRIC_BYTES]);
+	return !(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+}
+
+static int open_counter(pid_t pid, uint32_t type, uint64_t config) {
+	struct perf_event_attr attr = {
+		.type = type,
+		.size = sizeof attr,
+		.config = config,
+		.disabled = 1,
+		.enable_on_exec = 1,
+		.exclude_hv = 1,
+	};
+	int fd = (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+	if (fd == -1) {
+		// Unprivileged users may only count user space events.
+		attr.exclude_kernel = 1;
+		fd = (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+	}
+	return fd;
+}
+
+static double read_counter(int fd) {
+	uint64_t value;
+	if (fd == -1 || read(fd, &value, sizeof value) != sizeof value) {
+		return -1;
+	}
+	return (double)value;
+}
+
+static double median(struct sample *samples, size_t samples_number, enum metric metric) {
+	double *values;
+	double result;
+	values = malloc(samples_number * sizeof *values);
+	if (values == nullptr) {
+		return 0;
+	}
+	for (size_t i = 0; i < samples_number; i++) {
+		values[i] = samples[i].values[metric];
+	}
+	qsort(values, samples_number, sizeof *values, compare_doubles);
+	result = values[samples_number / 2];
+	free(values);
+	return result;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double value_a = *(const double *)a;
+	double value_b = *(const double *)b;
+	return (value_a > value_b) - (value_a < value_b);
+}
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
@@ -0,0 +1,7 @@
+#include <stdlib.h>
+
+/* A tool that does nothing, the cost of starting any process. */
+
+int main(void) {
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,16 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+
+/*
+ * Linked into the sample tools, writes the allocation counters to the file
+ * descriptor named by ARGPARSER_COLDSTART_FD once the tool exits.
+ */
+[[gnu::destructor]] static void report_allocations(void) {
+	const char *fd = getenv("ARGPARSER_COLDSTART_FD");
+	struct alloc_stats stats = alloc_counter_read();
+	if (fd) {
+		dprintf(atoi(fd), "%zu %zu\n", stats.allocations, stats.bytes);
+	}
+}
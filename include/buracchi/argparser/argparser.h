@@ -16,8 +16,17 @@
 #include <stdio.h>
 
 #include <buracchi/argparser/argument-action-store.h>
+#include <buracchi/argparser/config.h>
+#include <buracchi/argparser/constraints.h>
 #include <buracchi/argparser/exit.h>
+#include <buracchi/argparser/help-catalog.h>
+#include <buracchi/argparser/limits.h>
+#include <buracchi/argparser/record.h>
+#include <buracchi/argparser/stats.h>
+#include <buracchi/argparser/stream.h>
 #include <buracchi/argparser/sub-commands.h>
+#include <buracchi/argparser/tokenizer.h>
+#include <buracchi/argparser/trace.h>
 #include <buracchi/argparser/types.h>
 
 static const char argparser_suppress[] = "==SUPPRESS==";
@@ -81,6 +90,26 @@ extern void argparser_set_usage(argparser_t argparser, const char *usage);
  */
 extern void argparser_set_description(argparser_t argparser, const char *description);
 
+/**
+ * @brief Set the characters that prefix optional arguments.
+ *
+ * @details Most command-line options use - as the prefix, e.g. -f/--foo.
+ * Parsers that need to support different or additional prefix characters,
+ * e.g. for options like +f or /foo, may specify them using this function.
+ * A token is an optional if its first character is any of the prefix
+ * characters and a long optional if its second one is too; usage and help
+ * messages display flags with the first prefix character.
+ * Supplying a set of characters that does not include - will cause -f/--foo
+ * options to be disallowed.
+ * Subparsers added afterwards use the same prefix characters.
+ *
+ * @param argparser the argument parser object.
+ * @param prefix_chars The set of characters that prefix optional arguments
+ * (default: "-").
+ * @return 0 on success, 1 if prefix_chars is empty.
+ */
+extern int argparser_set_prefix_chars(argparser_t argparser, const char *prefix_chars);
+
 #define argparser_add_argument argparser_add_argument_action_store
 
 extern int argparser_add_argument_action_store_true(argparser_t argparser,
@@ -91,6 +120,93 @@ extern int argparser_add_argument_action_store_false(argparser_t argparser,
                                                      bool *result,
                                                      struct argparser_argument argument);
 
+/**
+ * @brief Add an option counting the number of times it occurs.
+ *
+ * @details The result is set to zero and incremented on every occurrence,
+ * e.g. -vvv or -v -v -v set it to 3. This is useful for increasing verbosity
+ * levels.
+ *
+ * @param argparser the argument parser object.
+ * @param result the integer to store the count in.
+ * @param argument the option specification.
+ * @return 0 on success, 1 on failure.
+ */
+extern int argparser_add_argument_action_count(argparser_t argparser,
+                                               int *result,
+                                               struct argparser_argument argument);
+
+/**
+ * @brief Describe an argument stored in result, for argparser_add_arguments().
+ *
+ * @details The type of the argument is deduced from result, the remaining
+ * fields are given as designated initializers, e.g.
+ * argparser_argument_of(&verbose, .flag = "v", .action = ARGPARSER_ACTION_STORE_TRUE).
+ */
+#define argparser_argument_of(result, ...)                                                    \
+	((struct argparser_argument){ .destination = (void **)(result),                       \
+	                              .type = argparser_type_of(*(result)),                   \
+	                              __VA_ARGS__ })
+
+/**
+ * @brief Add many arguments at once.
+ *
+ * @details Every specification must set its destination and type, as
+ * argparser_argument_of() does, and its action must be one of
+ * ARGPARSER_ACTION_STORE, ARGPARSER_ACTION_STORE_TRUE,
+ * ARGPARSER_ACTION_STORE_FALSE or ARGPARSER_ACTION_COUNT, with the same
+ * meaning as in the single argument functions. A char ** destination, of type
+ * ARGPARSER_TYPE_CSTR_LIST, must select a list with the action_nargs field
+ * and only it can. All the specifications are
+ * validated before any is added and the storage grows once, so either all
+ * the arguments are added or none is.
+ *
+ * @param argparser the argument parser object.
+ * @param specs the argument specifications.
+ * @param specs_number the number of specifications.
+ * @return 0 on success, 1 if a specification is invalid or on failure.
+ */
+extern int argparser_add_arguments(argparser_t argparser,
+                                   const struct argparser_argument specs[],
+                                   size_t specs_number);
+
+/**
+ * @brief Make room for arguments_number arguments in total.
+ *
+ * @details The arguments added afterwards, up to arguments_number, do not
+ * allocate. Without it the storage doubles whenever it is full.
+ *
+ * @param argparser the argument parser object.
+ * @param arguments_number the number of arguments, the help option included.
+ * @return 0 on success, 1 on failure.
+ */
+extern int argparser_reserve_arguments(argparser_t argparser, size_t arguments_number);
+
+/**
+ * @brief Include the options of parent in the parser.
+ *
+ * @details Sometimes, several parsers share a common set of options. Rather
+ * than registering them in every parser, they can be added once to a parent
+ * parser which is then referenced by all the others: its options are matched,
+ * shown in help and usage messages and checked for being required as if they
+ * were added to the parser, but they are stored and indexed only once, so
+ * building a tree of subcommands sharing options costs as much as the unique
+ * options. The options of the parser come first and those of its parents
+ * follow in the order the parents were added; the help option of a parent is
+ * never included. Parents store in their own destinations, which all their
+ * children share.
+ * The parent must be fully initialized, it can have neither positional
+ * arguments, subcommands nor parents of its own and it cannot be modified
+ * afterwards: adding arguments or subcommands to it fails. It must outlive
+ * the parsers referencing it. The keys of a configuration file only match
+ * the own arguments of a parser.
+ *
+ * @param argparser the argument parser object.
+ * @param parent the parser whose options are included.
+ * @return 0 on success, 1 if parent cannot be a parent or on failure.
+ */
+extern int argparser_add_parent(argparser_t argparser, argparser_t parent);
+
 #define argparser_parse_argsN(N3, N2, N1, N, ...) argparser_parse_args##N
 
 extern int argparser_parse_args1(argparser_t argparser);
@@ -118,6 +234,75 @@ extern int argparser_parse_args3(argparser_t argparser, const char *args[const],
 	argparser_parse_argsN(argparaser __VA_OPT__(, ) __VA_ARGS__, 3, 2, 1, 0)( \
 		argparaser __VA_OPT__(, ) __VA_ARGS__)
 
+/**
+ * @brief Convert the argument strings the parser knows, leaving the others.
+ *
+ * @details Works like argparser_parse_args() but, instead of exiting with an
+ * error, collects the unrecognized tokens, including the ones of the selected
+ * subcommand, so that they can be forwarded to another program.
+ * An options terminator (--) ends the options: it is consumed and the
+ * following tokens are only matched to positional arguments.
+ * The leftovers are written in their original order followed by nullptr,
+ * ready to be passed to execv(). No memory is allocated for them.
+ *
+ * @param argparser the argument parser object.
+ * @param args the argument strings.
+ * @param args_size the number of argument strings.
+ * @param leftovers an array of at least args_size + 1 elements receiving the
+ * unrecognized tokens. It may be args itself, in which case the leftovers are
+ * compacted in place.
+ * @param leftovers_number receives the number of leftovers.
+ *
+ * @returns 0 on success, 1 otherwise.
+ */
+extern int argparser_parse_known_args(argparser_t argparser,
+                                      const char *args[const],
+                                      size_t args_size,
+                                      char **leftovers,
+                                      size_t *leftovers_number);
+
+/**
+ * @brief Convert the leading options, stopping at the first operand.
+ *
+ * @details POSIX mode, equivalent to POSIXLY_CORRECT or to a leading '+' in
+ * the getopt() option string: parsing ends at the first token that is not an
+ * option, i.e. a positional argument or a subcommand, or after an options
+ * terminator (--). The tokens that follow are never examined, so the cost of
+ * the parse only depends on the leading options.
+ * Positional arguments and subcommands are left to the caller and are not
+ * required, missing required options are still reported.
+ *
+ * @param argparser the argument parser object.
+ * @param args the argument strings.
+ * @param args_size the number of argument strings.
+ * @param first_operand receives the position in args of the first operand,
+ * args_size if there is none.
+ *
+ * @returns 0 on success, 1 otherwise.
+ */
+extern int argparser_parse_options(argparser_t argparser,
+                                   const char *args[const],
+                                   size_t args_size,
+                                   size_t *first_operand);
+
+/**
+ * @brief Convert the argument strings stored one after the other in a buffer.
+ *
+ * @details Works like argparser_parse_args() on the tokens of a blob where
+ * every token is terminated by a NUL byte, as written by find -print0 or found
+ * in /proc/<pid>/cmdline (whose first token is the program name and should be
+ * skipped). The buffer is walked in place and no argv array is built; string
+ * destinations point into the buffer, which must outlive them.
+ *
+ * @param argparser the argument parser object.
+ * @param buffer the tokens.
+ * @param length the size of the buffer in bytes, including the terminator of
+ * the last token.
+ *
+ * @returns 0 on success, 1 if the last token is not terminated or on failure.
+ */
+extern int argparser_parse_buffer(argparser_t argparser, const char *buffer, size_t length);
+
 /*******************************************************************************
  * 				           Help-formatting functions
  **
@@ -216,36 +401,10 @@ extern const char *argparser_get_program_name(argparser_t argparser);
  *		@ref argparser::formatter argument.
  *		(default: none)
  *
- * @var argparser::parents
- *		@brief A nullptr terminated list of argparser object references
- *		whose arguments should also be included
- *		@details Sometimes, several parsers share a common set of
- *arguments. Rather than repeating the definitions of these arguments, a single
- *		parser with all the shared arguments passed via the
- *		@ref argparser::parents argument to the argparser objects
- *can be used. It takes a list of argparser object references, collects all
- *the positional and optional actions from them, and adds these actions to the
- *argparser object being constructed. Note that most parent parsers will
- *specify argparser::add_help as false. Otherwise, the ArgumentParser will
- *see two -h/--help options (one in the parent and one in the child) and raise
- *an error. Note You must fully initialize the parsers before passing them via
- *		@ref argparser::parents.
- *		If you change a parent parsers after the child parser
- *initialization, those changes will not be reflected in the child.
- *
  * @var argparser::formatter
  *		@brief A class for customizing the help output
  *		@details Currently undocumented
  *
- * @var argparser::prefix_chars
- *		@brief The set of characters that prefix optional arguments
- *		@details Most command-line options will use - as the prefix,
- *e.g. -f/--foo. Parsers that need to support different or additional prefix
- *characters, e.g. for options like +f or /foo, may specify them using this
- *argument. The prefix_chars argument defaults to '-'. Supplying a set of
- *characters that does not include - will cause -f/--foo options to be
- *disallowed.
- *
  * @var argparser::fromfile_prefix_chars
  *		@brief The set of characters that prefix files from which
  *		additional arguments should be read
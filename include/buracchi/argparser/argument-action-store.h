@@ -22,9 +22,35 @@ extern int argparser_add_argument_action_store_uint(argparser_t argparser,
                                                     unsigned int *result,
                                                     struct argparser_argument argument);
 
+extern int argparser_add_argument_action_store_string_view(argparser_t argparser,
+                                                           struct argparser_string_view *result,
+                                                           struct argparser_argument argument);
+
+/**
+ * @brief Add a positional argument taking a list of strings.
+ *
+ * @details The action_nargs field selects how many tokens the list takes,
+ * ARGPARSER_ACTION_NARGS_LIST (one or more) if it is not a list one. The
+ * tokens are split among the positionals in a single pass: each one takes as
+ * many tokens as it can while leaving enough for the ones after it, so
+ * "src... dst" gives all the tokens but the last to src. The result points to
+ * a nullptr terminated array owned by the parser, valid until the next parse.
+ *
+ * @param argparser the argument parser object.
+ * @param result the list.
+ * @param argument the argument specification.
+ * @return 0 on success, 1 on failure.
+ */
+extern int argparser_add_argument_action_store_cstr_list(argparser_t argparser,
+                                                         char ***result,
+                                                         struct argparser_argument argument);
+
 #define argparser_add_argument_action_store(argparser, result, ...)               \
 	_Generic((result),                                                        \
 	        char **: argparser_add_argument_action_store_cstr,                \
+	        char ***: argparser_add_argument_action_store_cstr_list,          \
+	        struct argparser_string_view *:                                   \
+	                argparser_add_argument_action_store_string_view,          \
 	        int *: argparser_add_argument_action_store_int,                   \
 	        long int *: argparser_add_argument_action_store_long,             \
 	        unsigned short int *: argparser_add_argument_action_store_ushort, \
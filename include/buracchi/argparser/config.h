@@ -0,0 +1,167 @@
+#pragma once
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * Programs with many options usually let the user keep them in a
+ * configuration file instead of repeating them on every invocation.
+ * A configuration file is a sequence of lines of the form
+ *
+ *     key = value
+ *
+ * where key is the long flag of an option (e.g. max-count for --max-count),
+ * its destination form (e.g. max_count) or the name of a positional argument.
+ * Blank lines and lines starting with '#' or ';' are ignored, leading and
+ * trailing whitespaces around keys and values are stripped.
+ *
+ * Values go through the same conversions used for the command line.
+ * They take precedence over the default values and are overridden by the
+ * arguments given on the command line.
+ * Keys that do not belong to any argument are reported as errors together with
+ * their line number, as are keys of arguments that cannot take a single value
+ * from a file: lists, constants other than booleans and the actions collecting
+ * several values.
+ */
+
+/**
+ * @brief Set the configuration file read by argparser_parse_args().
+ *
+ * @details The file is mapped in memory and split in place, keys and values
+ * are never copied and string results point directly into the mapping, which
+ * stays valid until the argparser object is destroyed.
+ * Calling this function again replaces the previous configuration file.
+ *
+ * @param argparser the argument parser object.
+ * @param path the path of the configuration file.
+ * @return 0 on success, 1 otherwise.
+ */
+extern int argparser_set_config_file(argparser_t argparser, const char *path);
+
+/**
+ * Long running programs can pick up changes to the configuration file without
+ * restarting once reloading has been enabled with
+ * argparser_enable_config_reload().
+ * A reload parses the file again into a shadow buffer, leaving the destinations
+ * given to argparser_add_argument() untouched. If every value is valid the
+ * shadow buffer is published atomically as the new snapshot, otherwise the
+ * current snapshot is kept. Arguments given on the command line keep their
+ * value across reloads.
+ *
+ * Reader threads get the current snapshot with argparser_config_snapshot()
+ * without taking any lock. Snapshots are double buffered: the second reload
+ * following the publication of a snapshot rewrites it. Readers that may
+ * overlap such a reload validate what they read, as with a sequence lock:
+ *
+ *     do {
+ *             snapshot = argparser_config_snapshot(parser);
+ *             generation = argparser_snapshot_generation(snapshot);
+ *             count = *(const int *)argparser_snapshot_get(snapshot, &count_option);
+ *     } while (!argparser_snapshot_validate(snapshot, generation));
+ */
+struct argparser_snapshot;
+
+/**
+ * @brief Enable reloading of the configuration file.
+ *
+ * @details Must be called before argparser_parse_args(). With reloading enabled
+ * the configuration file is read in private memory instead of being mapped, so
+ * that editing it in place does not alter the values in use, and the values of
+ * every parse are captured in the first snapshot.
+ *
+ * @param argparser the argument parser object.
+ * @return 0 on success, 1 otherwise.
+ */
+extern int argparser_enable_config_reload(argparser_t argparser);
+
+/**
+ * @brief Watch the configuration file for changes.
+ *
+ * @details Must be called after argparser_parse_args(). The returned file
+ * descriptor becomes readable when the file is written or replaced and can be
+ * added to the event loop of the program, argparser_config_poll() must be
+ * called when that happens. Only supported on Linux.
+ *
+ * @param argparser the argument parser object.
+ * @return the file descriptor to wait on, -1 on error or if not supported.
+ */
+extern int argparser_config_watch(argparser_t argparser);
+
+/**
+ * @brief Reload the configuration file if the watcher reported a change.
+ *
+ * @param argparser the argument parser object.
+ * @return 0 if nothing changed or the reload succeeded, 1 if the reload failed.
+ */
+extern int argparser_config_poll(argparser_t argparser);
+
+/**
+ * @brief Parse the configuration file again and publish a new snapshot.
+ *
+ * @details Must be called after argparser_parse_args().
+ *
+ * @param argparser the argument parser object.
+ * @return 0 on success, 1 if the file could not be read or contains an
+ * unknown key or an invalid value, in which case the current snapshot is kept.
+ */
+extern int argparser_config_reload(argparser_t argparser);
+
+/**
+ * @brief Get the current snapshot of the argument values.
+ *
+ * @param argparser the argument parser object.
+ * @return the current snapshot or nullptr if no configuration file was parsed.
+ */
+extern const struct argparser_snapshot *argparser_config_snapshot(argparser_t argparser);
+
+/**
+ * @brief Get the value of an argument from a snapshot.
+ *
+ * @param snapshot the snapshot.
+ * @param destination the result pointer given when the argument was added.
+ * @return a pointer to the value, with the same type of destination, or
+ * nullptr if no argument stores its result in destination. The value may be
+ * rewritten by the second reload that follows, see
+ * argparser_snapshot_validate().
+ */
+extern const void *argparser_snapshot_get(const struct argparser_snapshot *snapshot,
+                                          const void *destination);
+
+/**
+ * @brief Get the generation of a snapshot, to be validated once the values
+ * have been read.
+ *
+ * @param snapshot the snapshot.
+ * @return the generation of the snapshot.
+ */
+extern size_t argparser_snapshot_generation(const struct argparser_snapshot *snapshot);
+
+/**
+ * @brief Check that a snapshot was not rewritten while its values were read.
+ *
+ * @details Values read through a pointer returned by argparser_snapshot_get()
+ * must be copied before the check, a pointer is not valid on its own.
+ *
+ * @param snapshot the snapshot.
+ * @param generation the generation returned by argparser_snapshot_generation()
+ * before the values were read.
+ * @return true if the values read are consistent, false if they must be read
+ * again from the current snapshot.
+ */
+extern bool argparser_snapshot_validate(const struct argparser_snapshot *snapshot, size_t generation);
+
+/**
+ * @brief Return the number of arguments whose value changed with the reload
+ * that published the snapshot.
+ */
+extern size_t argparser_snapshot_changes_number(const struct argparser_snapshot *snapshot);
+
+/**
+ * @brief Iterate over the arguments whose value changed with the reload that
+ * published the snapshot.
+ *
+ * @param snapshot the snapshot.
+ * @param position the iteration state, must be set to 0 before the first call.
+ * @return the next changed argument or nullptr when there are no more.
+ */
+extern const struct argparser_argument *
+argparser_snapshot_next_change(const struct argparser_snapshot *snapshot, size_t *position);
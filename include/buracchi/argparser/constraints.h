@@ -0,0 +1,60 @@
+#pragma once
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * Constraint groups relate arguments given on the command line: at most one
+ * of a mutually exclusive group, all or none of a required together group,
+ * and all the others whenever the first of a requires group is given. The
+ * groups are compiled into bitmasks over the arguments of the parser the
+ * first time it parses after they change, and checked against the arguments
+ * given with a few word operations per group at the end of every parse.
+ * A parse violating a constraint prints the usage and an error naming the
+ * two arguments involved, as in "argument --all: not allowed with argument
+ * --none", and exits. The violation is recorded beforehand and can be
+ * retrieved with argparser_get_constraint_error().
+ */
+
+/**
+ * @enum argparser_constraint
+ *
+ * @brief The relation between the arguments of a group.
+ */
+enum argparser_constraint {
+	ARGPARSER_CONSTRAINT_NONE,
+	ARGPARSER_CONSTRAINT_MUTUALLY_EXCLUSIVE, /* at most one is given */
+	ARGPARSER_CONSTRAINT_REQUIRED_TOGETHER,  /* all or none are given */
+	ARGPARSER_CONSTRAINT_REQUIRES,           /* the first requires all the others */
+};
+
+struct argparser_constraint_error {
+	enum argparser_constraint constraint;      /* ARGPARSER_CONSTRAINT_NONE if none was violated */
+	const struct argparser_argument *argument; /* a given argument of the group */
+	const struct argparser_argument *other;    /* the other one given or the one missing */
+};
+
+/**
+ * @brief Add a constraint group.
+ *
+ * @details The arguments are named by their destination, as the keys of a
+ * configuration file: the long flag of an option, the name of a positional
+ * or, failing both, the short flag. They must be added, to the parser or to
+ * one of its parents, before the group.
+ *
+ * @param argparser the argument parser object.
+ * @param constraint the relation between the arguments.
+ * @param keys the nullptr terminated list of at least two arguments, the list
+ * is copied but the strings must outlive the parser.
+ * @return 0 on success, 1 if an argument does not exist or on failure.
+ */
+extern int argparser_add_constraint(argparser_t argparser, enum argparser_constraint constraint, const char *const keys[]);
+
+/**
+ * @brief Get the constraint violated by the last parse started from
+ * argparser.
+ *
+ * @param argparser the argument parser object.
+ * @return the violation, its constraint is ARGPARSER_CONSTRAINT_NONE if the
+ * last parse satisfied every group.
+ */
+extern struct argparser_constraint_error argparser_get_constraint_error(argparser_t argparser);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * Programs with many commands carry a lot of help text that is only read when
+ * the help is printed. The help of an argument or subparser and the
+ * descriptions of a parser can reference an entry of a help catalog instead,
+ * which is a separate file with the same format of configuration files:
+ *
+ *     verbose = print more information while working
+ *
+ * The catalog is only mapped the first time a help message needs it, parsing
+ * never touches it. References to missing entries, or without a catalog, are
+ * printed as their key.
+ */
+
+/**
+ * @brief Reference the entry key of the help catalog.
+ *
+ * @details The reference is a string literal starting with a byte that never
+ * occurs in help text and can be used wherever a help string is expected.
+ */
+#define argparser_help_key(key) ("\x1d" key)
+
+/**
+ * @brief Set the help catalog of argparser and of its subparsers.
+ *
+ * @details Only the path is recorded, the file is mapped and indexed the first
+ * time a help reference is resolved and stays mapped until the argparser
+ * object is destroyed. Subparsers added later share the same catalog.
+ * Calling this function again replaces the previous catalog.
+ *
+ * @param argparser the argument parser object.
+ * @param path the path of the help catalog, it must outlive the parser.
+ */
+extern void argparser_set_help_catalog(argparser_t argparser, const char *path);
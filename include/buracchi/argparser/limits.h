@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * Limits bound the work and the memory a single parse may use, so that
+ * command lines from untrusted sources, e.g. received from the network, cannot
+ * make the parser allocate without bound. The token limits are checked before
+ * anything is allocated; a parse exceeding a limit returns 1 without printing
+ * anything or exiting and the violation can be retrieved with
+ * argparser_get_limit_error().
+ * The limits of the parser the parse starts from also apply to its
+ * subcommands.
+ */
+
+/**
+ * @brief Per-parse limits, a zero field means unlimited.
+ */
+struct argparser_limits {
+	size_t max_tokens;           /* tokens in the command line */
+	size_t max_token_length;     /* bytes of a single token, terminator excluded */
+	size_t max_total_bytes;      /* bytes of all the tokens, terminators included */
+	size_t max_subcommand_depth; /* nested subcommands */
+	size_t max_scratch_bytes;    /* memory allocated while parsing */
+};
+
+/**
+ * @enum argparser_limit
+ *
+ * @brief The limit a parse exceeded.
+ */
+enum argparser_limit {
+	ARGPARSER_LIMIT_NONE,
+	ARGPARSER_LIMIT_TOKENS,
+	ARGPARSER_LIMIT_TOKEN_LENGTH,
+	ARGPARSER_LIMIT_TOTAL_BYTES,
+	ARGPARSER_LIMIT_SUBCOMMAND_DEPTH,
+	ARGPARSER_LIMIT_SCRATCH_BYTES,
+};
+
+struct argparser_limit_error {
+	enum argparser_limit limit; /* ARGPARSER_LIMIT_NONE if no limit was exceeded */
+	size_t maximum;             /* the configured value of the limit */
+	size_t token_index;         /* the token being parsed when it was exceeded */
+};
+
+/**
+ * @brief Set the limits applied by the following parses.
+ *
+ * @param argparser the argument parser object.
+ * @param limits the limits.
+ */
+extern void argparser_set_limits(argparser_t argparser, struct argparser_limits limits);
+
+/**
+ * @brief Get the limit exceeded by the last parse started from argparser.
+ *
+ * @param argparser the argument parser object.
+ * @return the violation, its limit is ARGPARSER_LIMIT_NONE if the last parse
+ * stayed within the limits.
+ */
+extern struct argparser_limit_error argparser_get_limit_error(argparser_t argparser);
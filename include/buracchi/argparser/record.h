@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * In record mode the arguments are described as fields of a struct, by offset
+ * and type, instead of being bound to variables. Every parse fills the struct
+ * instance it is given, so many command lines can be parsed into an array of
+ * records and each parse writes a single block of memory:
+ *
+ *     struct options { int level; char *name; bool verbose; };
+ *     argparser_add_field(parser, struct options, level, { .long_flag = "level" });
+ *     argparser_add_field(parser, struct options, name, { .name = "name" });
+ *     argparser_add_field(parser, struct options, verbose, { .flag = "v", .action = ARGPARSER_ACTION_STORE_TRUE });
+ *     for (size_t i = 0; i < n; i++) {
+ *             argparser_parse_record(parser, commands[i], sizes[i], &records[i]);
+ *     }
+ *
+ * The arguments of a parser in record mode, and of its subparsers and parents,
+ * must all be fields of the same struct: once a parser or one of its
+ * subparsers has a field, adding a variable to any of them fails, and the
+ * other way round, as does adding a parent of the other mode. Such parsers can
+ * only be parsed with argparser_parse_record(); they cannot be streamed or
+ * reload their configuration file.
+ */
+
+/**
+ * @brief Return the argparser_type of an expression, used by
+ * argparser_add_field().
+ *
+ * @details A char ** member is a list of strings, its argument must select a
+ * list with the action_nargs field. The lists of every record stay valid until
+ * the parser is destroyed.
+ */
+#define argparser_type_of(expression)                              \
+	_Generic((expression),                                     \
+	        bool: ARGPARSER_TYPE_BOOL,                         \
+	        char *: ARGPARSER_TYPE_CSTR,                       \
+	        const char *: ARGPARSER_TYPE_CSTR,                 \
+	        char **: ARGPARSER_TYPE_CSTR_LIST,                 \
+	        int: ARGPARSER_TYPE_INT,                           \
+	        long int: ARGPARSER_TYPE_LONG,                     \
+	        unsigned short int: ARGPARSER_TYPE_USHORT,         \
+	        unsigned int: ARGPARSER_TYPE_UINT,                 \
+	        struct argparser_string_view: ARGPARSER_TYPE_STRING_VIEW)
+
+/**
+ * @brief Add an argument stored in a member of the record type.
+ *
+ * @details The action field selects how the member is set, as in
+ * argparser_add_argument(): ARGPARSER_ACTION_STORE_TRUE and
+ * ARGPARSER_ACTION_STORE_FALSE for bool members, ARGPARSER_ACTION_COUNT for
+ * int members and ARGPARSER_ACTION_STORE, the default, for any member.
+ *
+ * @param argparser the argument parser object.
+ * @param record_type the struct type of the records.
+ * @param member the member of record_type storing the argument.
+ * @param ... the argument specification.
+ * @return 0 on success, 1 if the parser binds variables or on failure.
+ */
+#define argparser_add_field(argparser, record_type, member, ...)                              \
+	argparser_add_field_at((argparser),                                                   \
+	                       offsetof(record_type, member),                                 \
+	                       argparser_type_of(((record_type *)nullptr)->member),           \
+	                       (struct argparser_argument)__VA_ARGS__)
+
+/**
+ * @brief Add an argument stored at offset in the records.
+ *
+ * @param argparser the argument parser object.
+ * @param offset the offset of the member in the record.
+ * @param type the type of the member.
+ * @param argument the argument specification.
+ * @return 0 on success, 1 if the parser binds variables or on failure.
+ */
+extern int argparser_add_field_at(argparser_t argparser,
+                                  size_t offset,
+                                  enum argparser_type type,
+                                  struct argparser_argument argument);
+
+/**
+ * @brief Convert argument strings into a record.
+ *
+ * @details Works like argparser_parse_args() but stores the values in record.
+ * The fields of the parser and its parents are first reset from their
+ * defaults, one copy per run of adjacent fields: every field takes the default
+ * value of its argument, zero if it has none, false for
+ * ARGPARSER_ACTION_STORE_TRUE and true for ARGPARSER_ACTION_STORE_FALSE
+ * options. The fields of a subcommand are reset when it is reached, the other
+ * bytes of the record are left untouched.
+ *
+ * @param argparser the argument parser object.
+ * @param args the argument strings.
+ * @param args_size the number of argument strings.
+ * @param record the record to fill.
+ * @return 0 on success, 1 if the parser is not in record mode or on failure.
+ */
+extern int argparser_parse_record(argparser_t argparser, const char *args[const], size_t args_size, void *record);
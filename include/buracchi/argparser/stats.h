@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * Statistics are opt-in: once enabled with argparser_enable_stats() the
+ * parser, its subparsers, the formatters and the registration functions
+ * accumulate counters and the time spent in each phase until
+ * argparser_reset_stats() is called.
+ * When statistics are not enabled their cost is a single branch per update.
+ */
+
+/**
+ * @enum argparser_phase
+ *
+ * @brief Phases the time of the library is accounted to.
+ *
+ * @var argparser_phase::ARGPARSER_PHASE_MATCH
+ *      @brief matching command line tokens to arguments and subcommands.
+ *
+ * @var argparser_phase::ARGPARSER_PHASE_CONVERT
+ *      @brief converting values to the argument types.
+ *
+ * @var argparser_phase::ARGPARSER_PHASE_REQUIRED
+ *      @brief checking that the required arguments are present.
+ *
+ * @var argparser_phase::ARGPARSER_PHASE_DEFAULTS
+ *      @brief applying configuration files and default values.
+ *
+ * @var argparser_phase::ARGPARSER_PHASE_FORMAT
+ *      @brief formatting usage and help messages.
+ */
+enum argparser_phase {
+	ARGPARSER_PHASE_MATCH,
+	ARGPARSER_PHASE_CONVERT,
+	ARGPARSER_PHASE_REQUIRED,
+	ARGPARSER_PHASE_DEFAULTS,
+	ARGPARSER_PHASE_FORMAT,
+	ARGPARSER_PHASES_NUMBER,
+};
+
+struct argparser_stats {
+	size_t tokens;             /* command line tokens examined */
+	size_t lookups;            /* flag, positional and configuration key lookups */
+	size_t string_comparisons; /* flag, key and subcommand name comparisons */
+	size_t subcommand_hops;    /* descents into a subparser */
+	size_t allocations;        /* allocations made by the library */
+	size_t allocated_bytes;    /* bytes requested by those allocations */
+	uint64_t phase_ns[ARGPARSER_PHASES_NUMBER]; /* nanoseconds spent per phase */
+};
+
+/**
+ * @brief Start collecting statistics.
+ *
+ * @details Subparsers, including the ones added later, account to the
+ * statistics of the parser they belong to.
+ *
+ * @param argparser the argument parser object.
+ */
+extern void argparser_enable_stats(argparser_t argparser);
+
+/**
+ * @brief Get the statistics collected so far.
+ *
+ * @param argparser the argument parser object.
+ * @return a copy of the statistics, all zeros if they are not enabled.
+ */
+extern struct argparser_stats argparser_get_stats(argparser_t argparser);
+
+/**
+ * @brief Reset the statistics to zero.
+ *
+ * @param argparser the argument parser object.
+ */
+extern void argparser_reset_stats(argparser_t argparser);
+
+/**
+ * @brief Return the name of a phase (e.g. "match"), suitable as a metric label.
+ */
+extern const char *argparser_phase_name(enum argparser_phase phase);
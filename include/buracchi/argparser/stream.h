@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * A stream parses command line tokens as they arrive, e.g. from an interactive
+ * shell, instead of requiring the whole argv up front. Every token fed is
+ * matched, converted and stored right away and the outcome is reported as
+ * events the caller pulls with argparser_next_event(). Feeding a token costs
+ * a constant amount of work, except for the walk over clustered short flags
+ * and the lookup of a subcommand name.
+ * Errors are reported as events and never terminate the program; the help
+ * option is reported as any other option and does not print anything.
+ * Configuration files are not applied by streams.
+ */
+
+typedef struct argparser_stream *argparser_stream_t;
+
+/**
+ * @enum argparser_event_type
+ *
+ * @brief Events reported by a stream.
+ *
+ * @var argparser_event_type::ARGPARSER_EVENT_OPTION
+ *      @brief an option was matched, options without a value have already
+ *       taken effect.
+ *
+ * @var argparser_event_type::ARGPARSER_EVENT_VALUE
+ *      @brief a value was converted and stored in the argument destination.
+ *
+ * @var argparser_event_type::ARGPARSER_EVENT_SUBCOMMAND
+ *      @brief a subcommand was entered, the following tokens belong to the
+ *       subparser of the event.
+ *
+ * @var argparser_event_type::ARGPARSER_EVENT_ERROR
+ *      @brief the token or the command line is invalid, see the error field.
+ *
+ * @var argparser_event_type::ARGPARSER_EVENT_END
+ *      @brief the stream was finished.
+ */
+enum argparser_event_type {
+	ARGPARSER_EVENT_OPTION,
+	ARGPARSER_EVENT_VALUE,
+	ARGPARSER_EVENT_SUBCOMMAND,
+	ARGPARSER_EVENT_ERROR,
+	ARGPARSER_EVENT_END,
+};
+
+/**
+ * @enum argparser_stream_error
+ *
+ * @brief Errors reported by ARGPARSER_EVENT_ERROR events.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_NONE
+ *      @brief the event is not an error.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_UNRECOGNIZED
+ *      @brief the token does not match any argument.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_MISSING_VALUE
+ *      @brief the option of the event expected a value.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_INVALID_VALUE
+ *      @brief the token could not be converted to the argument type.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_INVALID_CHOICE
+ *      @brief the token is not one of the argument choices.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_INVALID_SUBCOMMAND
+ *      @brief the token is not the name of a subcommand.
+ *
+ * @var argparser_stream_error::ARGPARSER_STREAM_ERROR_MISSING_REQUIRED
+ *      @brief the argument of the event, or a subcommand if the argument is
+ *       nullptr, is required but was not given.
+ */
+enum argparser_stream_error {
+	ARGPARSER_STREAM_ERROR_NONE,
+	ARGPARSER_STREAM_ERROR_UNRECOGNIZED,
+	ARGPARSER_STREAM_ERROR_MISSING_VALUE,
+	ARGPARSER_STREAM_ERROR_INVALID_VALUE,
+	ARGPARSER_STREAM_ERROR_INVALID_CHOICE,
+	ARGPARSER_STREAM_ERROR_INVALID_SUBCOMMAND,
+	ARGPARSER_STREAM_ERROR_MISSING_REQUIRED,
+};
+
+struct argparser_event {
+	enum argparser_event_type type;
+	enum argparser_stream_error error;
+	argparser_t argparser; /* the parser, or subparser, the event belongs to */
+	size_t token_index;    /* number of tokens fed before the one of the event */
+	const char *token;     /* nullptr for events raised when finishing */
+	const struct argparser_argument *argument; /* nullptr if not relevant */
+};
+
+/**
+ * @brief Create a stream parsing tokens for argparser.
+ *
+ * @details The arguments of the parser, and of its subparsers, must not change
+ * while the stream is in use.
+ * Every token is bound as it arrives, so positionals taking an optional or
+ * variable number of values, which depend on the tokens that follow, are not
+ * supported.
+ *
+ * @param argparser the argument parser object.
+ * @return the stream or nullptr on failure, if argparser is in record mode or
+ * if it or one of its subparsers has positionals not taking a single value.
+ */
+extern argparser_stream_t argparser_stream_init(argparser_t argparser);
+
+extern void argparser_stream_destroy(argparser_stream_t stream);
+
+/**
+ * @brief Parse the next token.
+ *
+ * @details String destinations point into the token, which must outlive
+ * them.
+ *
+ * @param stream the stream.
+ * @param token the token.
+ * @return 0 on success, 1 on allocation failure or if the stream is finished.
+ */
+extern int argparser_stream_feed(argparser_stream_t stream, const char *token);
+
+/**
+ * @brief Signal the end of the tokens.
+ *
+ * @details Reports a missing option value and the missing required arguments
+ * and queues an ARGPARSER_EVENT_END event. The default values were already
+ * applied when the stream was created or the subcommand entered.
+ *
+ * @param stream the stream.
+ * @return 0 on success, 1 on allocation failure or if the stream is finished.
+ */
+extern int argparser_stream_finish(argparser_stream_t stream);
+
+/**
+ * @brief Pull the oldest event not yet returned.
+ *
+ * @param stream the stream.
+ * @param event receives the event.
+ * @return false if no event is pending.
+ */
+extern bool argparser_next_event(argparser_stream_t stream, struct argparser_event *event);
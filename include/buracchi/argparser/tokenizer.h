@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Split a command line in place following the POSIX shell quoting rules.
+ *
+ * @details Tokens are separated by blanks (space, tab and newline). Characters
+ * between single quotes are taken literally, between double quotes a backslash
+ * only escapes $, `, ", \ and newline, elsewhere it escapes any character; a
+ * backslash followed by a newline is removed. Quoted and unquoted parts that
+ * are not separated by blanks form a single token, so "" is an empty token.
+ * No expansion of any kind is performed.
+ *
+ * The quotes and the escaping backslashes are removed by moving the bytes of
+ * each token towards its start, so the tokens point into command and no
+ * memory is allocated. The result can be passed to argparser_parse_args():
+ *
+ *     char *argv[16];
+ *     size_t argc;
+ *     if (argparser_tokenize(line, argv, 16, &argc) == 0) {
+ *             argparser_parse_args(parser, (const char **)argv, argc);
+ *     }
+ *
+ * @param command the nullptr terminated command line, overwritten.
+ * @param argv receives the tokens followed by nullptr.
+ * @param argv_size the number of elements of argv.
+ * @param argc receives the number of tokens.
+ * @return 0 on success, 1 if a quote is not closed, if command ends with an
+ * escaping backslash or if argv is too small.
+ */
+extern int argparser_tokenize(char *command, char **argv, size_t argv_size, size_t *argc);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <buracchi/argparser/types.h>
+
+/**
+ * A trace callback receives an event for every decision the parser takes on a
+ * command line token, it is meant for debugging slow or unexpected parses.
+ * When no callback is set tracing costs a predicted branch per decision.
+ */
+
+/**
+ * @enum argparser_trace_decision
+ *
+ * @brief Decisions reported to the trace callback.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_POSITIONAL
+ *      @brief the token was classified as a positional argument.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_SHORT_FLAG
+ *      @brief the token was classified as a short flag.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_LONG_FLAG
+ *      @brief the token was classified as a long flag.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_MATCH
+ *      @brief the token matched the argument of the event.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_NO_MATCH
+ *      @brief the token did not match any argument.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_VALUE
+ *      @brief the token was consumed as the value of the argument of the event.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_SUBCOMMAND
+ *      @brief the token selected a subcommand, the following events come from
+ *       the subparser and their token indexes are relative to it.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_CONVERT
+ *      @brief the value was converted and stored in the argument destination.
+ *
+ * @var argparser_trace_decision::ARGPARSER_TRACE_CONVERT_FAILED
+ *      @brief the value could not be converted to the argument type.
+ */
+enum argparser_trace_decision {
+	ARGPARSER_TRACE_POSITIONAL,
+	ARGPARSER_TRACE_SHORT_FLAG,
+	ARGPARSER_TRACE_LONG_FLAG,
+	ARGPARSER_TRACE_MATCH,
+	ARGPARSER_TRACE_NO_MATCH,
+	ARGPARSER_TRACE_VALUE,
+	ARGPARSER_TRACE_SUBCOMMAND,
+	ARGPARSER_TRACE_CONVERT,
+	ARGPARSER_TRACE_CONVERT_FAILED,
+};
+
+struct argparser_trace_event {
+	uint64_t timestamp_ns; /* CLOCK_MONOTONIC time of the decision */
+	argparser_t argparser; /* the parser, or subparser, taking the decision */
+	size_t token_index;    /* index of the token in the parsed arguments */
+	const char *token;
+	enum argparser_trace_decision decision;
+	const struct argparser_argument *argument; /* nullptr if not relevant */
+};
+
+typedef void (*argparser_trace_callback)(const struct argparser_trace_event *event, void *user_data);
+
+/**
+ * @brief Set the callback receiving the parse decisions.
+ *
+ * @details Subparsers, including the ones added later, report to the same
+ * callback. The event is only valid for the duration of the call.
+ *
+ * @param argparser the argument parser object.
+ * @param callback the callback, nullptr disables tracing.
+ * @param user_data a pointer passed to every call of the callback.
+ */
+extern void argparser_set_trace_callback(argparser_t argparser,
+                                         argparser_trace_callback callback,
+                                         void *user_data);
+
+/**
+ * @brief Return the name of a decision (e.g. "match").
+ */
+extern const char *argparser_trace_decision_name(enum argparser_trace_decision decision);
@@ -125,6 +125,21 @@ enum argparser_type {
 	ARGPARSER_TYPE_LONG,
 	ARGPARSER_TYPE_USHORT,
 	ARGPARSER_TYPE_UINT,
+	ARGPARSER_TYPE_STRING_VIEW,
+	ARGPARSER_TYPE_CSTR_LIST, /* a char ** list, stored as ARGPARSER_TYPE_CSTR items */
+};
+
+/**
+ * @struct argparser_string_view
+ *
+ * @brief A string that is not copied, pointing into the argument strings.
+ *
+ * @details Values stored as views carry their length, e.g. the value of
+ * --name=joe is returned as the last three characters of the token itself.
+ */
+struct argparser_string_view {
+	const char *data;
+	size_t length;
 };
 
 /**
@@ -185,6 +200,8 @@ enum argparser_type {
  * @var argparser_argument::default_value
  *      @brief Specify a pointer to the value that should be used if the
  *      command-line argument is not present.
+ *      For strings the pointer is the value itself. The defaults are stored
+ *      before every parse, so repeated parses start from them.
  *      On error message will be generated if there wasn’t at least one
  *      command-line argument present if the argument was positional
  *      or if it was an option with the required field set to true.
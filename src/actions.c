@@ -1,166 +1,250 @@
 #include <buracchi/argparser/argparser.h>
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <buracchi/common/utilities/try.h>
 
+#include "stats.h"
 #include "struct_argparser.h"
 
+static int add_bound_argument(argparser_t argparser, struct argparser_argument argument);
+static int make_room(argparser_t argparser);
+static void prepare_action(struct argparser_argument *argument);
+static void append_argument(argparser_t argparser, const struct argparser_argument *argument);
+static bool is_valid_spec(const struct argparser_argument *spec);
+static bool is_valid_nargs(enum argparser_type type, enum argparser_action_nargs action_nargs);
+
 extern int argparser_add_argument_action_store_cstr(argparser_t argparser,
                                                     char **result,
                                                     struct argparser_argument argument) {
-	argparser->arguments_number++;
 	argument.action = ARGPARSER_ACTION_STORE;
 	argument.type = ARGPARSER_TYPE_CSTR;
 	argument.destination = (void **)result;
-	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
-	    nullptr,
-	    fail);
-	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
-	return 0;
-fail:
-	return 1;
+	return add_bound_argument(argparser, argument);
+}
+
+extern int argparser_add_argument_action_store_cstr_list(argparser_t argparser,
+                                                         char ***result,
+                                                         struct argparser_argument argument) {
+	argument.action = ARGPARSER_ACTION_STORE;
+	argument.type = ARGPARSER_TYPE_CSTR;
+	argument.destination = (void **)result;
+	if (argument.action_nargs == ARGPARSER_ACTION_NARGS_SINGLE ||
+	    argument.action_nargs == ARGPARSER_ACTION_NARGS_OPTIONAL) {
+		argument.action_nargs = ARGPARSER_ACTION_NARGS_LIST;
+	}
+	return add_bound_argument(argparser, argument);
 }
 
 extern int argparser_add_argument_action_store_ushort(argparser_t argparser,
                                                       unsigned short int *result,
                                                       struct argparser_argument argument) {
-	argparser->arguments_number++;
 	argument.action = ARGPARSER_ACTION_STORE;
 	argument.type = ARGPARSER_TYPE_USHORT;
 	argument.destination = (void **)result;
-	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
-	    nullptr,
-	    fail);
-	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
-	return 0;
-fail:
-	return 1;
+	return add_bound_argument(argparser, argument);
 }
 
 extern int argparser_add_argument_action_store_uint(argparser_t argparser,
                                                     unsigned int *result,
                                                     struct argparser_argument argument) {
-	argparser->arguments_number++;
 	argument.action = ARGPARSER_ACTION_STORE;
 	argument.type = ARGPARSER_TYPE_UINT;
 	argument.destination = (void **)result;
-	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
-	    nullptr,
-	    fail);
-	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
-	return 0;
-fail:
-	return 1;
+	return add_bound_argument(argparser, argument);
 }
 
 extern int argparser_add_argument_action_store_int(argparser_t argparser,
                                                    int *result,
                                                    struct argparser_argument argument) {
-	argparser->arguments_number++;
 	argument.action = ARGPARSER_ACTION_STORE;
 	argument.type = ARGPARSER_TYPE_INT;
 	argument.destination = (void **)result;
-	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
-	    nullptr,
-	    fail);
-	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
-	return 0;
-fail:
-	return 1;
+	return add_bound_argument(argparser, argument);
 }
 
 extern int argparser_add_argument_action_store_long(argparser_t argparser,
                                                     long int *result,
                                                     struct argparser_argument argument) {
-	argparser->arguments_number++;
 	argument.action = ARGPARSER_ACTION_STORE;
 	argument.type = ARGPARSER_TYPE_LONG;
 	argument.destination = (void **)result;
-	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
-	    nullptr,
-	    fail);
-	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
-	return 0;
-fail:
-	return 1;
+	return add_bound_argument(argparser, argument);
+}
+
+extern int argparser_add_argument_action_store_string_view(argparser_t argparser,
+                                                           struct argparser_string_view *result,
+                                                           struct argparser_argument argument) {
+	argument.action = ARGPARSER_ACTION_STORE;
+	argument.type = ARGPARSER_TYPE_STRING_VIEW;
+	argument.destination = (void **)result;
+	return add_bound_argument(argparser, argument);
 }
 
 extern int argparser_add_argument_action_store_true(argparser_t argparser,
                                                     bool *result,
                                                     struct argparser_argument argument) {
-	argparser->arguments_number++;
-	argument.action = ARGPARSER_ACTION_STORE_CONST;
+	argument.action = ARGPARSER_ACTION_STORE_TRUE;
 	argument.type = ARGPARSER_TYPE_BOOL;
 	argument.destination = (void **)result;
-	argument.const_value = (void *)true;
-	*result = false;
-	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
-	    nullptr,
-	    fail);
-	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
-	return 0;
-fail:
-	return 1;
+	return add_bound_argument(argparser, argument);
 }
 
 extern int argparser_add_argument_action_store_false(argparser_t argparser,
                                                      bool *result,
                                                      struct argparser_argument argument) {
-	argparser->arguments_number++;
-	argument.action = ARGPARSER_ACTION_STORE_CONST;
+	argument.action = ARGPARSER_ACTION_STORE_FALSE;
 	argument.type = ARGPARSER_TYPE_BOOL;
 	argument.destination = (void **)result;
-	argument.const_value = (void *)false;
-	*result = true;
+	return add_bound_argument(argparser, argument);
+}
+
+extern int argparser_add_argument_action_count(argparser_t argparser,
+                                               int *result,
+                                               struct argparser_argument argument) {
+	argument.action = ARGPARSER_ACTION_COUNT;
+	argument.type = ARGPARSER_TYPE_INT;
+	argument.destination = (void **)result;
+	return add_bound_argument(argparser, argument);
+}
+
+extern int argparser_add_field_at(argparser_t argparser,
+                                  size_t offset,
+                                  enum argparser_type type,
+                                  struct argparser_argument argument) {
+	try(accepts_destinations(argparser, true), false, fail);
+	try(is_valid_nargs(type, argument.action_nargs), false, fail);
+	try(make_room(argparser), 1, fail);
+	argument.type = (type == ARGPARSER_TYPE_CSTR_LIST) ? ARGPARSER_TYPE_CSTR : type;
+	// The offset stands for the address until a record is given to the parse.
+	argument.destination = (void **)(uintptr_t)offset;
+	bind_destinations(argparser, true);
+	prepare_action(&argument);
+	append_argument(argparser, &argument);
+	return 0;
+fail:
+	return 1;
+}
+
+extern int argparser_add_arguments(argparser_t argparser, const struct argparser_argument specs[], size_t specs_number) {
+	for (size_t i = 0; i < specs_number; i++) {
+		try(is_valid_spec(&specs[i]), false, fail);
+	}
+	try(argparser->is_shared, true, fail);
+	try(accepts_destinations(argparser, false), false, fail);
+	try(argparser_reserve_arguments(argparser, argparser->arguments_number + specs_number), 1, fail);
+	for (size_t i = 0; i < specs_number; i++) {
+		// Cannot fail, the room was reserved above.
+		add_bound_argument(argparser, specs[i]);
+	}
+	return 0;
+fail:
+	return 1;
+}
+
+extern int argparser_reserve_arguments(argparser_t argparser, size_t arguments_number) {
 	struct argparser_argument *reallocated_address;
-	try(reallocated_address =
-	            realloc(argparser->arguments,
-	                    sizeof *argparser->arguments * argparser->arguments_number),
+	if (arguments_number <= argparser->arguments_capacity) {
+		return 0;
+	}
+	// Without capacity the arguments are the shared builtin help, never freed.
+	try(reallocated_address = realloc(argparser->arguments_capacity ? argparser->arguments : nullptr,
+	                                  sizeof *argparser->arguments * arguments_number),
 	    nullptr,
 	    fail);
+	if (argparser->arguments_capacity == 0) {
+		memcpy(reallocated_address, argparser->arguments, sizeof *argparser->arguments * argparser->arguments_number);
+	}
 	argparser->arguments = reallocated_address;
-	memcpy(&(argparser->arguments[argparser->arguments_number - 1]),
-	       &argument,
-	       sizeof *argparser->arguments);
+	argparser->arguments_capacity = arguments_number;
+	stats_count_allocation(argparser, sizeof *argparser->arguments * arguments_number);
+	return 0;
+fail:
+	return 1;
+}
+
+static int add_bound_argument(argparser_t argparser, struct argparser_argument argument) {
+	try(accepts_destinations(argparser, false), false, fail);
+	try(make_room(argparser), 1, fail);
+	bind_destinations(argparser, false);
+	if (argument.type == ARGPARSER_TYPE_CSTR_LIST) {
+		argument.type = ARGPARSER_TYPE_CSTR;
+	}
+	prepare_action(&argument);
+	switch (argument.action) {
+	case ARGPARSER_ACTION_STORE_CONST:
+		if (argument.type == ARGPARSER_TYPE_BOOL) {
+			*(bool *)argument.destination = !argument.const_value;
+		}
+		break;
+	case ARGPARSER_ACTION_COUNT:
+		*(int *)argument.destination = 0;
+		break;
+	default:
+		break;
+	}
+	append_argument(argparser, &argument);
 	return 0;
 fail:
 	return 1;
 }
+
+/*
+ * Double the storage when it is full, so that adding N arguments copies O(N).
+ * The arguments of a parent are referenced by its children and never change.
+ */
+static int make_room(argparser_t argparser) {
+	size_t capacity = argparser->arguments_capacity;
+	if (argparser->is_shared) {
+		return 1;
+	}
+	if (argparser->arguments_number < capacity) {
+		return 0;
+	}
+	return argparser_reserve_arguments(argparser, capacity ? capacity * 2 : 4);
+}
+
+/* Turn the boolean shorthands into the constants they store. */
+static void prepare_action(struct argparser_argument *argument) {
+	switch (argument->action) {
+	case ARGPARSER_ACTION_STORE_TRUE:
+	case ARGPARSER_ACTION_STORE_FALSE:
+		argument->const_value = (argument->action == ARGPARSER_ACTION_STORE_TRUE) ? (void *)true : (void *)false;
+		argument->action = ARGPARSER_ACTION_STORE_CONST;
+		break;
+	default:
+		break;
+	}
+}
+
+static inline void append_argument(argparser_t argparser, const struct argparser_argument *argument) {
+	memcpy(&(argparser->arguments[argparser->arguments_number]), argument, sizeof *argparser->arguments);
+	argparser->arguments_number++;
+}
+
+static bool is_valid_spec(const struct argparser_argument *spec) {
+	if (spec->destination == nullptr || (!spec->name && !spec->flag && !spec->long_flag) ||
+	    spec->type > ARGPARSER_TYPE_CSTR_LIST) {
+		return false;
+	}
+	switch (spec->action) {
+	case ARGPARSER_ACTION_STORE:
+		return is_valid_nargs(spec->type, spec->action_nargs);
+	case ARGPARSER_ACTION_STORE_TRUE:
+	case ARGPARSER_ACTION_STORE_FALSE:
+		return spec->type == ARGPARSER_TYPE_BOOL && !spec->name;
+	case ARGPARSER_ACTION_COUNT:
+		return spec->type == ARGPARSER_TYPE_INT && !spec->name;
+	default:
+		return false;
+	}
+}
+
+/* Only a list of strings is stored as a list, so that the destination matches. */
+static bool is_valid_nargs(enum argparser_type type, enum argparser_action_nargs action_nargs) {
+	bool is_list = action_nargs == ARGPARSER_ACTION_NARGS_LIST_OF_N || action_nargs == ARGPARSER_ACTION_NARGS_LIST ||
+	               action_nargs == ARGPARSER_ACTION_NARGS_LIST_OPTIONAL;
+	return is_list == (type == ARGPARSER_TYPE_CSTR_LIST);
+}
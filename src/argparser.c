@@ -7,26 +7,34 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "catalog.h"
+#include "config.h"
+#include "constraints.h"
+#include "defaults.h"
+#include "index.h"
+#include "pool.h"
+#include "stats.h"
 #include "struct_argparser.h"
 #include "utils.h"
 
+const struct argparser_argument builtin_help = {
+	.flag = "h",
+	.long_flag = "help",
+	.action = ARGPARSER_ACTION_HELP,
+	.help = "show this help message and exit",
+};
+
 extern argparser_t argparser_init(int argc, const char *argv[argc + 1]) {
 	struct {
 		struct argparser argparser;
 		char default_program_name[];
 	} *mblock;
 
-	struct argparser_argument *arguments;
 	size_t default_program_name_size = (argc ? strlen(argv[0]) + 1 : 0);
 	mblock = malloc(sizeof *mblock + default_program_name_size);
 	if (mblock == nullptr) {
 		return nullptr;
 	}
-	arguments = malloc(sizeof *arguments);
-	if (arguments == nullptr) {
-		free(mblock);
-		return nullptr;
-	}
 	if (argc) {
 		basename(argv[0], default_program_name_size, mblock->default_program_name);
 	}
@@ -39,11 +47,24 @@ extern argparser_t argparser_init(int argc, const char *argv[argc + 1]) {
 		.description = nullptr,
 		.epilog = nullptr,
 		.arguments_number = 1,
-		.arguments = arguments,
+		.arguments_capacity = 0,
+		// Not written until copied by the first argument added.
+		.arguments = (struct argparser_argument *)&builtin_help,
 		.add_help = true,
 		.exit_on_error = true,
 		.subparsers_number = 0,
 		.subparsers = nullptr,
+		.index = { 0 },
+		.config = nullptr,
+		.is_config_reload_enabled = false,
+		.reload = nullptr,
+		.stats = nullptr,
+		.catalog = nullptr,
+		.trace_callback = nullptr,
+		.trace_data = nullptr,
+		.char_class = { ['-'] = CHAR_CLASS_PREFIX },
+		.short_prefix = "-",
+		.long_prefix = "--",
 		.subparsers_options =
 			(struct argparser_subparsers_options){
 							      .title = nullptr,
@@ -54,12 +75,7 @@ extern argparser_t argparser_init(int argc, const char *argv[argc + 1]) {
 							      .metavar = nullptr,
 							      },
 	};
-	arguments[0] = (struct argparser_argument){
-		.flag = "h",
-		.long_flag = "help",
-		.action = ARGPARSER_ACTION_HELP,
-		.help = "show this help message and exit",
-	};
+	mblock->argparser.pool = &mblock->argparser.pool_storage;
 	return &mblock->argparser;
 }
 
@@ -67,8 +83,26 @@ extern void argparser_destroy(argparser_t argparser) {
 	for (size_t i = 0; i < argparser->subparsers_number; i++) {
 		argparser_destroy(argparser->subparsers[i].parser);
 	}
-	free(argparser->arguments);
-	free(argparser);
+	if (argparser->reload) {
+		config_reload_destroy(argparser);
+	}
+	else if (argparser->config) {
+		config_source_destroy(argparser->config);
+	}
+	argument_index_destroy(&argparser->index);
+	defaults_image_destroy(&argparser->defaults);
+	constraints_destroy(&argparser->constraints);
+	help_catalog_destroy(&argparser->catalog_storage);
+	free(argparser->positional_lists);
+	free(argparser->parents);
+	free(argparser->subparsers);
+	if (argparser->arguments_capacity) {
+		free(argparser->arguments);
+	}
+	if (!argparser->is_pooled) {
+		pool_destroy(&argparser->pool_storage);
+		free(argparser);
+	}
 }
 
 extern void argparser_error(argparser_t argparser, const char *message) {
@@ -98,6 +132,54 @@ extern inline void argparser_set_program_name(argparser_t argparser, const char
 	                                  program_name;
 }
 
+extern int argparser_set_prefix_chars(argparser_t argparser, const char *prefix_chars) {
+	if (prefix_chars == nullptr || *prefix_chars == '\0') {
+		return 1;
+	}
+	memset(argparser->char_class, 0, sizeof argparser->char_class);
+	for (const char *c = prefix_chars; *c; c++) {
+		argparser->char_class[(unsigned char)*c] |= CHAR_CLASS_PREFIX;
+	}
+	argparser->short_prefix[0] = prefix_chars[0];
+	argparser->long_prefix[0] = prefix_chars[0];
+	argparser->long_prefix[1] = prefix_chars[0];
+	return 0;
+}
+
+extern void argparser_set_limits(argparser_t argparser, struct argparser_limits limits) {
+	argparser->limits = limits;
+}
+
+extern struct argparser_limit_error argparser_get_limit_error(argparser_t argparser) {
+	return argparser->limit_error;
+}
+
+extern int argparser_add_parent(argparser_t argparser, argparser_t parent) {
+	argparser_t *parents;
+	if (parent == argparser || parent->parents_number || parent->subparsers_number) {
+		return 1;
+	}
+	if ((parent->is_record || parent->is_bound) && !accepts_destinations(argparser, parent->is_record)) {
+		return 1;
+	}
+	for (size_t i = 0; i < parent->arguments_number; i++) {
+		if (parent->arguments[i].name) {
+			return 1;
+		}
+	}
+	try(parents = realloc(argparser->parents, (argparser->parents_number + 1) * sizeof *parents), nullptr, fail);
+	stats_count_allocation(argparser, (argparser->parents_number + 1) * sizeof *parents);
+	argparser->parents = parents;
+	argparser->parents[argparser->parents_number++] = parent;
+	if (parent->is_record || parent->is_bound) {
+		bind_destinations(argparser, parent->is_record);
+	}
+	parent->is_shared = true;
+	return 0;
+fail:
+	return 1;
+}
+
 extern void argparser_set_usage(argparser_t argparser, const char *usage) {
 	argparser->usage = usage;
 }
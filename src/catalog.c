@@ -0,0 +1,73 @@
+#include "catalog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+
+#define HELP_KEY_MARKER '\x1d'
+
+static void set_catalog(argparser_t argparser, struct help_catalog *catalog);
+static void load(argparser_t argparser, struct help_catalog *catalog);
+static int compare_entries(const void *a, const void *b);
+
+extern void argparser_set_help_catalog(argparser_t argparser, const char *path) {
+	help_catalog_destroy(&argparser->catalog_storage);
+	argparser->catalog_storage = (struct help_catalog){ .path = path };
+	set_catalog(argparser, &argparser->catalog_storage);
+}
+
+extern const char *help_catalog_text(argparser_t argparser, const char *text) {
+	struct help_catalog *catalog = argparser->catalog;
+	struct config_entry key;
+	const struct config_entry *entry;
+	if (text == nullptr || text[0] != HELP_KEY_MARKER) {
+		return text;
+	}
+	key = (struct config_entry){ .key = text + 1 };
+	if (catalog == nullptr) {
+		return key.key;
+	}
+	if (!catalog->is_loaded) {
+		load(argparser, catalog);
+	}
+	if (catalog->source == nullptr) {
+		return key.key;
+	}
+	entry = bsearch(&key,
+	                catalog->source->entries,
+	                catalog->source->entries_number,
+	                sizeof *catalog->source->entries,
+	                compare_entries);
+	return (entry && entry->value) ? entry->value : key.key;
+}
+
+extern void help_catalog_destroy(struct help_catalog *catalog) {
+	if (catalog->source) {
+		config_source_destroy(catalog->source);
+	}
+	*catalog = (struct help_catalog){ 0 };
+}
+
+static void set_catalog(argparser_t argparser, struct help_catalog *catalog) {
+	argparser->catalog = catalog;
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		set_catalog(argparser->subparsers[i].parser, catalog);
+	}
+}
+
+/* A catalog that cannot be read is not tried again, its keys are printed. */
+static void load(argparser_t argparser, struct help_catalog *catalog) {
+	catalog->is_loaded = true;
+	catalog->source = config_source_open(argparser, catalog->path, false);
+	if (catalog->source) {
+		qsort(catalog->source->entries,
+		      catalog->source->entries_number,
+		      sizeof *catalog->source->entries,
+		      compare_entries);
+	}
+}
+
+static int compare_entries(const void *a, const void *b) {
+	return strcmp(((const struct config_entry *)a)->key, ((const struct config_entry *)b)->key);
+}
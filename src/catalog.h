@@ -0,0 +1,19 @@
+#pragma once
+
+#include "struct_argparser.h"
+
+/*
+ * The help catalog maps keys to help text. Help strings starting with the
+ * reference marker are looked up in it when a help message is formatted, the
+ * file is opened and sorted by key on the first lookup.
+ */
+
+/**
+ * @brief Get the text to print for a help string.
+ *
+ * @return text itself if it is not a reference, the catalog entry it refers
+ * to or, if there is none, the key of the reference.
+ */
+extern const char *help_catalog_text(argparser_t argparser, const char *text);
+
+extern void help_catalog_destroy(struct help_catalog *catalog);
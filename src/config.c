@@ -0,0 +1,201 @@
+#include "config.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "stats.h"
+#include "utils.h"
+#include "values.h"
+
+static int map_file(argparser_t argparser, struct config_source *config);
+static int tokenize(argparser_t argparser, struct config_source *config, size_t size);
+static inline bool is_blank(char c);
+
+extern int argparser_set_config_file(argparser_t argparser, const char *path) {
+	struct config_source *config;
+	try(config = config_source_open(argparser, path, argparser->is_config_reload_enabled), nullptr, fail);
+	if (argparser->config && !config_reload_references(argparser, argparser->config)) {
+		config_source_destroy(argparser->config);
+	}
+	argparser->config = config;
+	return 0;
+fail:
+	return 1;
+}
+
+extern struct config_source *config_source_open(argparser_t argparser, const char *path, bool is_private_copy) {
+	struct config_source *config;
+	try(config = malloc(sizeof *config), nullptr, fail);
+	stats_count_allocation(argparser, sizeof *config);
+	*config = (struct config_source){ .path = path, .is_private_copy = is_private_copy };
+	try(map_file(argparser, config), 1, fail2);
+	return config;
+fail2:
+	config_source_destroy(config);
+fail:
+	return nullptr;
+}
+
+extern void config_source_destroy(struct config_source *config) {
+	if (config->mapping_size) {
+		munmap(config->data, config->mapping_size);
+	}
+	free(config->entries);
+	free(config);
+}
+
+extern bool config_entry_value(const struct argparser_argument *argument,
+                               const struct config_entry *entry,
+                               void *result) {
+	bool value = true;
+	switch (argument->action) {
+	case ARGPARSER_ACTION_STORE:
+		return entry->value && is_valid_choice(argument, entry->value) &&
+		       convert_value(argument->type, entry->value, result);
+	case ARGPARSER_ACTION_COUNT:
+		return entry->value && convert_value(argument->type, entry->value, result);
+	case ARGPARSER_ACTION_STORE_CONST:
+		if (argument->type != ARGPARSER_TYPE_BOOL ||
+		    (entry->value && !strtobool(entry->value, &value))) {
+			return false;
+		}
+		*(bool *)result = value ? (bool)argument->const_value : !(bool)argument->const_value;
+		return true;
+	default:
+		return false;
+	}
+}
+
+extern bool config_argument_is_settable(const struct argparser_argument *argument) {
+	switch (argument->action) {
+	case ARGPARSER_ACTION_STORE:
+		return argument->action_nargs == ARGPARSER_ACTION_NARGS_SINGLE ||
+		       argument->action_nargs == ARGPARSER_ACTION_NARGS_OPTIONAL;
+	case ARGPARSER_ACTION_COUNT:
+		return true;
+	case ARGPARSER_ACTION_STORE_CONST:
+		return argument->type == ARGPARSER_TYPE_BOOL;
+	default:
+		return false;
+	}
+}
+
+/*
+ * The file is mapped privately and writable so that keys and values can be
+ * terminated in place, only the touched pages get copied by the kernel.
+ * An anonymous region one byte larger than the file is reserved first and the
+ * file is mapped over it, this way the byte past the end of the file is always
+ * addressable and can terminate a value not followed by a newline.
+ * Private copies read the file in the anonymous region instead, a file mapping
+ * would see (or fault on) edits made in place while the values are in use.
+ */
+static int map_file(argparser_t argparser, struct config_source *config) {
+	struct stat file_stat;
+	size_t size;
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	int fd;
+	void *region;
+	try(fd = open(config->path, O_RDONLY), -1, fail);
+	try(fstat(fd, &file_stat), -1, fail2);
+	size = (size_t)file_stat.st_size;
+	if (size == 0) {
+		close(fd);
+		return 0;
+	}
+	config->mapping_size = (size + 1 + page_size - 1) / page_size * page_size;
+	try(region = mmap(nullptr,
+	                  config->mapping_size,
+	                  PROT_READ | PROT_WRITE,
+	                  MAP_PRIVATE | MAP_ANONYMOUS,
+	                  -1,
+	                  0),
+	    MAP_FAILED,
+	    fail3);
+	config->data = region;
+	if (config->is_private_copy) {
+		ssize_t bytes_read;
+		size_t offset = 0;
+		while (offset < size && (bytes_read = read(fd, config->data + offset, size - offset)) > 0) {
+			offset += bytes_read;
+		}
+		size = offset;
+	}
+	else {
+		try(mmap(region, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0),
+		    MAP_FAILED,
+		    fail2);
+	}
+	close(fd);
+	return tokenize(argparser, config, size);
+fail3:
+	config->mapping_size = 0;
+fail2:
+	close(fd);
+fail:
+	return 1;
+}
+
+static int tokenize(argparser_t argparser, struct config_source *config, size_t size) {
+	char *const end = config->data + size;
+	size_t lines_number = 1;
+	size_t line = 0;
+	for (const char *p = config->data; (p = memchr(p, '\n', end - p)); p++) {
+		lines_number++;
+	}
+	try(config->entries = malloc(lines_number * sizeof *config->entries), nullptr, fail);
+	stats_count_allocation(argparser, lines_number * sizeof *config->entries);
+	for (char *p = config->data; p < end; p++) {
+		char *line_end = memchr(p, '\n', end - p);
+		char *key;
+		char *key_end;
+		char *value;
+		char *value_end;
+		char *separator;
+		line++;
+		if (line_end == nullptr) {
+			line_end = end;
+		}
+		key = p;
+		p = line_end;
+		while (key < line_end && is_blank(*key)) {
+			key++;
+		}
+		if (key == line_end || *key == '#' || *key == ';') {
+			continue;
+		}
+		separator = memchr(key, '=', line_end - key);
+		key_end = separator ? separator : line_end;
+		while (key_end > key && is_blank(key_end[-1])) {
+			key_end--;
+		}
+		value = separator ? separator + 1 : line_end;
+		while (value < line_end && is_blank(*value)) {
+			value++;
+		}
+		value_end = line_end;
+		while (value_end > value && is_blank(value_end[-1])) {
+			value_end--;
+		}
+		*key_end = '\0';
+		*value_end = '\0';
+		config->entries[config->entries_number++] = (struct config_entry){
+			.key = key,
+			.key_len = key_end - key,
+			.value = separator ? value : nullptr,
+			.line = line,
+		};
+	}
+	return 0;
+fail:
+	return 1;
+}
+
+static inline bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "struct_argparser.h"
+
+/**
+ * @brief Map and split the configuration file at path.
+ *
+ * @param argparser the parser the allocations are accounted to.
+ * @param path the path of the configuration file.
+ * @param is_private_copy if true the file is read in private memory instead of
+ * being mapped, so that later edits do not affect the values already in use.
+ * @return the new configuration source or nullptr on error.
+ */
+extern struct config_source *config_source_open(argparser_t argparser, const char *path, bool is_private_copy);
+
+extern void config_source_destroy(struct config_source *config);
+
+/**
+ * @brief Tell whether a configuration entry can give a value to argument.
+ *
+ * @details Single values, counters and boolean flags can be set, the help
+ * option, lists and the actions collecting several values cannot.
+ */
+extern bool config_argument_is_settable(const struct argparser_argument *argument);
+
+/**
+ * @brief Convert the value of a configuration entry for an argument.
+ *
+ * @details Options storing a constant accept a boolean value selecting whether
+ * the constant or its negation is stored, a key without value stores the
+ * constant.
+ *
+ * @param argument the argument the entry key refers to, it must be settable.
+ * @param entry the configuration entry.
+ * @param result where to store the converted value.
+ * @return true on success, false if the value is missing or invalid.
+ */
+extern bool config_entry_value(const struct argparser_argument *argument,
+                               const struct config_entry *entry,
+                               void *result);
+
+/*
+ * Reload support, the values of the last parse are captured so that the
+ * configuration file can be parsed again into a shadow snapshot.
+ */
+
+/* seen is the bitset of the arguments given on the command line. */
+extern int config_reload_prepare(argparser_t argparser, const uint64_t *seen);
+
+extern void config_reload_publish(argparser_t argparser);
+
+extern bool config_reload_references(argparser_t argparser, const struct config_source *source);
+
+/* Destroy the reload state together with every configuration source. */
+extern void config_reload_destroy(argparser_t argparser);
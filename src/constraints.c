@@ -0,0 +1,191 @@
+#include "constraints.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "index.h"
+#include "stats.h"
+
+static int constraints_compile(argparser_t argparser);
+static bool find_position(argparser_t argparser, const char *key, size_t *position);
+static bool check_group(argparser_t argparser,
+                        const struct constraint_group *group,
+                        const uint64_t *seen,
+                        struct argparser_constraint_error *error);
+
+extern int argparser_add_constraint(argparser_t argparser, enum argparser_constraint constraint, const char *const keys[]) {
+	struct constraints *constraints = &argparser->constraints;
+	struct constraint_group *groups;
+	const char **copy;
+	size_t keys_number = 0;
+	if (constraint == ARGPARSER_CONSTRAINT_NONE || constraint > ARGPARSER_CONSTRAINT_REQUIRES) {
+		return 1;
+	}
+	for (; keys[keys_number]; keys_number++) {
+		size_t position;
+		try(find_position(argparser, keys[keys_number], &position), false, fail);
+	}
+	if (keys_number < 2) {
+		return 1;
+	}
+	try(copy = malloc((keys_number + 1) * sizeof *copy), nullptr, fail);
+	try(groups = realloc(constraints->groups, (constraints->groups_number + 1) * sizeof *groups), nullptr, fail2);
+	stats_count_allocation(argparser, (keys_number + 1) * sizeof *copy);
+	stats_count_allocation(argparser, (constraints->groups_number + 1) * sizeof *groups);
+	memcpy(copy, keys, (keys_number + 1) * sizeof *copy);
+	constraints->groups = groups;
+	constraints->groups[constraints->groups_number++] = (struct constraint_group){
+		.constraint = constraint,
+		.keys = copy,
+	};
+	constraints->arguments_number = 0;
+	return 0;
+fail2:
+	free(copy);
+fail:
+	return 1;
+}
+
+extern struct argparser_constraint_error argparser_get_constraint_error(argparser_t argparser) {
+	return argparser->constraint_error;
+}
+
+extern int constraints_check(argparser_t argparser, const uint64_t *seen, struct argparser_constraint_error *error) {
+	struct constraints *constraints = &argparser->constraints;
+	if (constraints->groups_number == 0) {
+		return 0;
+	}
+	if (constraints->arguments_number != arguments_total(argparser)) {
+		try(constraints_compile(argparser), 1, fail);
+	}
+	for (size_t i = 0; i < constraints->groups_number; i++) {
+		if (!check_group(argparser, &constraints->groups[i], seen, error)) {
+			return 1;
+		}
+	}
+	return 0;
+fail:
+	return 1;
+}
+
+extern void constraints_destroy(struct constraints *constraints) {
+	for (size_t i = 0; i < constraints->groups_number; i++) {
+		free(constraints->groups[i].keys);
+	}
+	free(constraints->groups);
+	free(constraints->words);
+	*constraints = (struct constraints){ 0 };
+}
+
+static int constraints_compile(argparser_t argparser) {
+	struct constraints *constraints = &argparser->constraints;
+	size_t words_number = 0;
+	uint64_t *words;
+	for (size_t i = 0; i < constraints->groups_number; i++) {
+		struct constraint_group *group = &constraints->groups[i];
+		size_t last_word = 0;
+		group->first_word = SIZE_MAX;
+		for (const char *const *key = group->keys; *key; key++) {
+			size_t position;
+			try(find_position(argparser, *key, &position), false, fail);
+			if (key == group->keys) {
+				group->requiring = position;
+			}
+			group->first_word = (position / 64 < group->first_word) ? position / 64 : group->first_word;
+			last_word = (position / 64 > last_word) ? position / 64 : last_word;
+		}
+		group->words_number = last_word - group->first_word + 1;
+		group->mask = words_number;
+		words_number += group->words_number;
+	}
+	try(words = calloc(words_number, sizeof *words), nullptr, fail);
+	stats_count_allocation(argparser, words_number * sizeof *words);
+	for (size_t i = 0; i < constraints->groups_number; i++) {
+		const struct constraint_group *group = &constraints->groups[i];
+		for (const char *const *key = group->keys; *key; key++) {
+			size_t position;
+			find_position(argparser, *key, &position);
+			bitset_set(words + group->mask, position - group->first_word * 64);
+		}
+	}
+	free(constraints->words);
+	constraints->words = words;
+	constraints->arguments_number = arguments_total(argparser);
+	return 0;
+fail:
+	return 1;
+}
+
+static bool find_position(argparser_t argparser, const char *key, size_t *position) {
+	const struct argparser_argument *argument = argument_index_find(argparser, key, strlen(key), true);
+	for (size_t i = 0; argument == nullptr && i < argparser->parents_number; i++) {
+		argument = argument_index_find(argparser->parents[i], key, strlen(key), true);
+		if (argument && argument->action == ARGPARSER_ACTION_HELP) {
+			argument = nullptr;
+		}
+	}
+	if (argument == nullptr) {
+		return false;
+	}
+	*position = argument_position(argparser, argument);
+	return true;
+}
+
+/*
+ * The first two arguments given and the first one missing are enough to tell
+ * whether a group is satisfied and to name the arguments violating it.
+ */
+static bool check_group(argparser_t argparser,
+                        const struct constraint_group *group,
+                        const uint64_t *seen,
+                        struct argparser_constraint_error *error) {
+	const uint64_t *mask = argparser->constraints.words + group->mask;
+	const uint64_t *words = seen + group->first_word;
+	size_t first_given = SIZE_MAX;
+	size_t second_given = SIZE_MAX;
+	size_t first_missing = SIZE_MAX;
+	size_t first = SIZE_MAX;
+	size_t other = SIZE_MAX;
+	for (size_t i = 0; i < group->words_number; i++) {
+		uint64_t given = words[i] & mask[i];
+		uint64_t missing = ~words[i] & mask[i];
+		size_t base = (group->first_word + i) * 64;
+		if (given && first_given == SIZE_MAX) {
+			first_given = base + (size_t)__builtin_ctzll(given);
+			given &= given - 1;
+		}
+		if (given && second_given == SIZE_MAX) {
+			second_given = base + (size_t)__builtin_ctzll(given);
+		}
+		if (missing && first_missing == SIZE_MAX) {
+			first_missing = base + (size_t)__builtin_ctzll(missing);
+		}
+	}
+	switch (group->constraint) {
+	case ARGPARSER_CONSTRAINT_MUTUALLY_EXCLUSIVE:
+		first = first_given;
+		other = second_given;
+		break;
+	case ARGPARSER_CONSTRAINT_REQUIRED_TOGETHER:
+		first = first_given;
+		other = first_missing;
+		break;
+	case ARGPARSER_CONSTRAINT_REQUIRES:
+		first = bitset_test(seen, group->requiring) ? group->requiring : SIZE_MAX;
+		other = first_missing;
+		break;
+	default:
+		break;
+	}
+	if (first == SIZE_MAX || other == SIZE_MAX) {
+		return true;
+	}
+	*error = (struct argparser_constraint_error){
+		.constraint = group->constraint,
+		.argument = argument_at(argparser, first),
+		.other = argument_at(argparser, other),
+	};
+	return false;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "struct_argparser.h"
+
+/*
+ * Every constraint group is compiled into a mask over the positions of the
+ * arguments, as numbered by the bitset of the arguments given, restricted to
+ * the words the group spans. Checking a group is then a few word operations
+ * against that bitset.
+ * The masks are compiled lazily whenever new arguments, parents or groups
+ * have been added.
+ */
+
+/**
+ * @brief Check the constraint groups of argparser.
+ *
+ * @param argparser the argument parser object.
+ * @param seen the bitset of the arguments given.
+ * @param error set to the violated constraint, if any.
+ * @return 0 if every group is satisfied, 1 if one is violated or the masks
+ * could not be compiled, error is left untouched in the latter case.
+ */
+extern int constraints_check(argparser_t argparser, const uint64_t *seen, struct argparser_constraint_error *error);
+
+extern void constraints_destroy(struct constraints *constraints);
@@ -0,0 +1,141 @@
+#include "defaults.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "stats.h"
+#include "values.h"
+
+static int defaults_image_build(argparser_t argparser);
+static bool has_default(const struct argparser_argument *argument, bool is_record);
+static void get_default(const struct argparser_argument *argument, void *value);
+
+extern int defaults_image_apply(argparser_t argparser, void *record) {
+	struct defaults_image *image = &argparser->defaults;
+	if (!image->is_built || image->arguments_number != argparser->arguments_number) {
+		try(defaults_image_build(argparser), 1, fail);
+	}
+	if (argparser->is_record && record == nullptr) {
+		return 1;
+	}
+	for (size_t i = 0; i < image->slots_number; i++) {
+		const struct default_slot *slot = &image->slots[i];
+		void *destination = slot->destination;
+		if (argparser->is_record) {
+			destination = (char *)record + (uintptr_t)slot->destination;
+		}
+		memcpy(destination, image->values + slot->offset, slot->size);
+	}
+	return 0;
+fail:
+	return 1;
+}
+
+extern void defaults_image_destroy(struct defaults_image *image) {
+	free(image->values);
+	free(image->slots);
+	*image = (struct defaults_image){ 0 };
+}
+
+/*
+ * In record mode a field extends the last run when it starts where the run
+ * ends, as consecutive members added in declaration order do.
+ */
+static int defaults_image_build(argparser_t argparser) {
+	struct defaults_image image = {
+		.arguments_number = argparser->arguments_number,
+		.is_built = true,
+	};
+	size_t values_size = 0;
+	size_t slots_number = 0;
+	for (size_t i = 0; i < argparser->arguments_number; i++) {
+		const struct argparser_argument *argument = &argparser->arguments[i];
+		if (!has_default(argument, argparser->is_record)) {
+			continue;
+		}
+		values_size += value_size(argument->type);
+		slots_number++;
+	}
+	try(image.values = calloc(values_size + 1, 1), nullptr, fail);
+	stats_count_allocation(argparser, values_size + 1);
+	if (slots_number) {
+		try(image.slots = malloc(slots_number * sizeof *image.slots), nullptr, fail2);
+		stats_count_allocation(argparser, slots_number * sizeof *image.slots);
+	}
+	values_size = 0;
+	for (size_t i = 0; i < argparser->arguments_number; i++) {
+		const struct argparser_argument *argument = &argparser->arguments[i];
+		struct default_slot *last = image.slots_number ? &image.slots[image.slots_number - 1] : nullptr;
+		size_t size = value_size(argument->type);
+		if (!has_default(argument, argparser->is_record)) {
+			continue;
+		}
+		get_default(argument, image.values + values_size);
+		if (argparser->is_record && last &&
+		    (uintptr_t)last->destination + last->size == (uintptr_t)argument->destination) {
+			last->size += size;
+		}
+		else {
+			image.slots[image.slots_number++] = (struct default_slot){
+				.destination = argument->destination,
+				.offset = values_size,
+				.size = size,
+			};
+		}
+		values_size += size;
+	}
+	defaults_image_destroy(&argparser->defaults);
+	argparser->defaults = image;
+	return 0;
+fail2:
+	free(image.values);
+fail:
+	return 1;
+}
+
+/*
+ * Every field of a record starts from a default, zero if none was given.
+ * Bound variables are only reset by the arguments that have a default, the
+ * flags and counters, and the optional strings that start from nullptr.
+ */
+static bool has_default(const struct argparser_argument *argument, bool is_record) {
+	switch (argument->action) {
+	case ARGPARSER_ACTION_STORE_CONST:
+		return argument->type == ARGPARSER_TYPE_BOOL;
+	case ARGPARSER_ACTION_COUNT:
+		return true;
+	case ARGPARSER_ACTION_STORE:
+		if (is_record || argument->default_value) {
+			return true;
+		}
+		return argument->type == ARGPARSER_TYPE_CSTR && !argument->is_required &&
+		       (!argument->name || argument->action_nargs == ARGPARSER_ACTION_NARGS_OPTIONAL);
+	default:
+		return false;
+	}
+}
+
+/*
+ * The default of a string is the default_value pointer itself, the default of
+ * the other types is the value it points to.
+ */
+static void get_default(const struct argparser_argument *argument, void *value) {
+	switch (argument->action) {
+	case ARGPARSER_ACTION_STORE_CONST:
+		*(bool *)value = !argument->const_value;
+		break;
+	case ARGPARSER_ACTION_COUNT:
+		*(int *)value = 0;
+		break;
+	default:
+		if (argument->type == ARGPARSER_TYPE_CSTR) {
+			memcpy(value, &argument->default_value, sizeof(char *));
+		}
+		else if (argument->default_value) {
+			memcpy(value, argument->default_value, value_size(argument->type));
+		}
+		break;
+	}
+}
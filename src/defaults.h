@@ -0,0 +1,26 @@
+#pragma once
+
+#include "struct_argparser.h"
+
+/*
+ * The defaults image holds the value every argument starts a parse from, so
+ * that defaults are applied before matching instead of looking for the
+ * arguments that were not given afterwards. It is a list of variables and the
+ * value each is reset to, in record mode a list of runs of fields adjacent in
+ * the record, so that each is reset with a single copy. A parser only writes
+ * its own fields, the ones of its parents and subparsers sharing the record
+ * are left alone.
+ * The image is rebuilt lazily whenever new arguments have been registered.
+ */
+
+/**
+ * @brief Reset the destinations of the arguments of argparser to their
+ * defaults.
+ *
+ * @param argparser the argument parser object.
+ * @param record the record to reset in record mode, ignored otherwise.
+ * @return 0 on success, 1 if the image could not be built.
+ */
+extern int defaults_image_apply(argparser_t argparser, void *record);
+
+extern void defaults_image_destroy(struct defaults_image *image);
@@ -2,9 +2,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <buracchi/common/utilities/utilities.h>
 
+#include "catalog.h"
+#include "stats.h"
 #include "struct_argparser.h"
 
 #include "arguments.h"
@@ -23,34 +26,45 @@ extern char *argparser_format_help(argparser_t argparser) {
 	char *optionals_description = nullptr;
 	char *positionals_description = nullptr;
 	char *subcommands_description = nullptr;
+	const char *description;
+	const char *subparsers_description;
+	enum argparser_phase previous_phase;
+	int length;
+	previous_phase = stats_enter_phase(argparser, ARGPARSER_PHASE_FORMAT);
 	usage_message = argparser_format_usage(argparser);
-	for (size_t i = 0; i < argparser->arguments_number; i++) {
-		struct argparser_argument *parg = &(argparser->arguments[i]);
+	struct argparser_argument *parg;
+	for (struct argument_cursor cursor = { 0 }; (parg = argument_next(argparser, &cursor));) {
 		char *str_vararg = get_arg_string(parg);
+		const char *help = help_catalog_text(argparser, parg->help);
 		char *old_description;
+		if (str_vararg) {
+			stats_count_allocation(argparser, strlen(str_vararg) + 1);
+		}
 		if (parg->name) {
 			old_description = positionals_description;
-			asprintf(&positionals_description,
-			         "%s  %s\t\t\t%s\n",
-			         positionals_description ? positionals_description : "",
-			         parg->name,
-			         parg->help ? parg->help : "");
+			length = asprintf(&positionals_description,
+			                  "%s  %s\t\t\t%s\n",
+			                  positionals_description ? positionals_description : "",
+			                  parg->name,
+			                  help ? help : "");
+			stats_count_allocation(argparser, (size_t)length + 1);
 		}
 		else {
 			old_description = optionals_description;
-			asprintf(&optionals_description,
-			         "%s  %s%s%s%s%s%s%s%s%s\t%s\n",
-			         optionals_description ? optionals_description : "",
-			         parg->flag ? "-" : "",
-			         parg->flag ? parg->flag : "",
-			         str_vararg ? " " : "",
-			         str_vararg ? str_vararg : "",
-			         parg->flag ? ", " : "",
-			         parg->long_flag ? "--" : "",
-			         parg->long_flag ? parg->long_flag : "",
-			         str_vararg ? " " : "",
-			         str_vararg ? str_vararg : "\t",
-			         parg->help ? parg->help : "");
+			length = asprintf(&optionals_description,
+			                  "%s  %s%s%s%s%s%s%s%s%s\t%s\n",
+			                  optionals_description ? optionals_description : "",
+			                  parg->flag ? argparser->short_prefix : "",
+			                  parg->flag ? parg->flag : "",
+			                  str_vararg ? " " : "",
+			                  str_vararg ? str_vararg : "",
+			                  parg->flag ? ", " : "",
+			                  parg->long_flag ? argparser->long_prefix : "",
+			                  parg->long_flag ? parg->long_flag : "",
+			                  str_vararg ? " " : "",
+			                  str_vararg ? str_vararg : "\t",
+			                  help ? help : "");
+			stats_count_allocation(argparser, (size_t)length + 1);
 		}
 		free(str_vararg);
 		free(old_description);
@@ -58,23 +72,25 @@ extern char *argparser_format_help(argparser_t argparser) {
 	for (size_t i = 0; i < argparser->subparsers_number; i++) {
 		char *old_subcommands_description;
 		old_subcommands_description = subcommands_description;
-		asprintf(&subcommands_description,
-		         "%s%s%s%s",
-		         old_subcommands_description ? old_subcommands_description : "  {",
-		         argparser->subparsers[i].command_name,
-		         (i < argparser->subparsers_number - 1) ? "," : "",
-		         (i == argparser->subparsers_number - 1) ? "}\n" : "");
+		length = asprintf(&subcommands_description,
+		                  "%s%s%s%s",
+		                  old_subcommands_description ? old_subcommands_description : "  {",
+		                  argparser->subparsers[i].command_name,
+		                  (i < argparser->subparsers_number - 1) ? "," : "",
+		                  (i == argparser->subparsers_number - 1) ? "}\n" : "");
+		stats_count_allocation(argparser, (size_t)length + 1);
 		free(old_subcommands_description);
 	}
 	for (size_t i = 0; i < argparser->subparsers_number; i++) {
 		if (argparser->subparsers[i].help) {
 			char *old_subcommands_description;
 			old_subcommands_description = subcommands_description;
-			asprintf(&subcommands_description,
-			         "%s    %s\t\t%s\n",
-			         old_subcommands_description,
-			         argparser->subparsers[i].command_name,
-			         argparser->subparsers[i].help);
+			length = asprintf(&subcommands_description,
+			                  "%s    %s\t\t%s\n",
+			                  old_subcommands_description,
+			                  argparser->subparsers[i].command_name,
+			                  help_catalog_text(argparser, argparser->subparsers[i].help));
+			stats_count_allocation(argparser, (size_t)length + 1);
 			free(old_subcommands_description);
 		}
 	}
@@ -82,31 +98,34 @@ extern char *argparser_format_help(argparser_t argparser) {
 	    argparser->subparsers_options.description) {
 		argparser->subparsers_options.title = "subcommands";
 	}
-	asprintf(&help_message,
-	         "%s\n%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
-	         usage_message,
-	         argparser->description ? argparser->description : "",
-	         argparser->description ? "\n" : "",
-	         positionals_description ? "\npositional arguments:\n" : "",
-	         positionals_description ? positionals_description : "",
-	         subcommands_description && !argparser->subparsers_options.title ?
-	                 subcommands_description :
-	                 "",
-	         optionals_description ? "\noptional arguments:\n" : "",
-	         optionals_description ? optionals_description : "",
-	         argparser->subparsers_options.title ? "\n" : "",
-	         argparser->subparsers_options.title ?
-	                 argparser->subparsers_options.title :
-	                 "",
-	         argparser->subparsers_options.title ? ":\n" : "",
-	         argparser->subparsers_options.description ? "  " : "",
-	         argparser->subparsers_options.description ?
-	                 argparser->subparsers_options.description :
-	                 "",
-	         argparser->subparsers_options.description ? "\n\n" : "",
-	         argparser->subparsers_options.title ? subcommands_description : "");
+	description = help_catalog_text(argparser, argparser->description);
+	subparsers_description = help_catalog_text(argparser, argparser->subparsers_options.description);
+	length = asprintf(&help_message,
+	                  "%s\n%s%s%s%s%s%s%s%s%s%s%s%s%s%s",
+	                  usage_message,
+	                  description ? description : "",
+	                  description ? "\n" : "",
+	                  positionals_description ? "\npositional arguments:\n" : "",
+	                  positionals_description ? positionals_description : "",
+	                  subcommands_description && !argparser->subparsers_options.title ?
+	                          subcommands_description :
+	                          "",
+	                  optionals_description ? "\noptional arguments:\n" : "",
+	                  optionals_description ? optionals_description : "",
+	                  argparser->subparsers_options.title ? "\n" : "",
+	                  argparser->subparsers_options.title ?
+	                          argparser->subparsers_options.title :
+	                          "",
+	                  argparser->subparsers_options.title ? ":\n" : "",
+	                  subparsers_description ? "  " : "",
+	                  subparsers_description ? subparsers_description : "",
+	                  subparsers_description ? "\n\n" : "",
+	                  argparser->subparsers_options.title ? subcommands_description : "");
+	stats_count_allocation(argparser, (size_t)length + 1);
 	free(usage_message);
 	free(optionals_description);
 	free(positionals_description);
+	free(subcommands_description);
+	stats_enter_phase(argparser, previous_phase);
 	return help_message;
 }
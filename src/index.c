@@ -0,0 +1,369 @@
+#include "index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "stats.h"
+
+static int argument_index_build(argparser_t argparser);
+static int length_buckets_build(argparser_t argparser,
+                                struct length_buckets *buckets,
+                                size_t keys_number,
+                                const char *(*key_at)(argparser_t argparser, size_t i));
+static size_t key_length(const char *key);
+static const char *long_flag_at(argparser_t argparser, size_t i);
+static const char *command_name_at(argparser_t argparser, size_t i);
+static bool is_stale(argparser_t argparser);
+static struct argparser_argument *find_in_parents(argparser_t argparser, const char *key, size_t key_len, char c);
+static const struct argument_hot *argument_index_probe(argparser_t argparser,
+                                                       const char *key,
+                                                       size_t key_len,
+                                                       bool fold_dest,
+                                                       bool is_long_flag);
+static const char *get_argument_key(const struct argparser_argument *argument);
+static uint32_t hash_key(const char *key, size_t key_len);
+static bool key_equals(const char *key, size_t key_len, const char *str, bool fold_dest);
+static char fold_char(char c);
+
+extern void argument_index_destroy(struct argument_index *index) {
+	free(index->slots);
+	free(index->positionals);
+	free(index->long_flags.items);
+	free(index->subcommands.items);
+	*index = (struct argument_index){ 0 };
+}
+
+extern const struct argument_index *argument_index_get(argparser_t argparser) {
+	if (is_stale(argparser)) {
+		try(argument_index_build(argparser), 1, fail);
+	}
+	return &argparser->index;
+fail:
+	return nullptr;
+}
+
+extern struct argparser_argument *argument_index_find(argparser_t argparser,
+                                                      const char *key,
+                                                      size_t key_len,
+                                                      bool fold_dest) {
+	const struct argument_hot *hot = argument_index_probe(argparser, key, key_len, fold_dest, false);
+	return hot ? &argparser->arguments[hot->position - 1] : nullptr;
+}
+
+extern struct argparser_argument *argument_index_find_long(argparser_t argparser, const char *key, size_t key_len) {
+	const struct argument_hot *hot = argument_index_probe(argparser, key, key_len, false, true);
+	if (hot == nullptr) {
+		return argparser->parents_number ? find_in_parents(argparser, key, key_len, '\0') : nullptr;
+	}
+	return &argparser->arguments[hot->position - 1];
+}
+
+extern struct argparser_argument *argument_index_find_short(argparser_t argparser, char c) {
+	struct argument_index *index = &argparser->index;
+	uint32_t position;
+	if (is_stale(argparser)) {
+		try(argument_index_build(argparser), 1, fail);
+	}
+	stats_add(argparser, lookups, 1);
+	if ((unsigned char)c >= SHORT_FLAGS_NUMBER) {
+		return nullptr;
+	}
+	position = index->short_flags[(unsigned char)c];
+	if (position == 0) {
+		return argparser->parents_number ? find_in_parents(argparser, nullptr, 0, c) : nullptr;
+	}
+	return &argparser->arguments[position - 1];
+fail:
+	return nullptr;
+}
+
+extern bool argument_index_is_cluster(argparser_t argparser, const char *cluster) {
+	for (; *cluster; cluster++) {
+		const struct argparser_argument *argument = argument_index_find_short(argparser, *cluster);
+		if (argument == nullptr) {
+			return false;
+		}
+		switch (argument->action) {
+		case ARGPARSER_ACTION_HELP:
+		case ARGPARSER_ACTION_STORE_CONST:
+		case ARGPARSER_ACTION_COUNT:
+			break;
+		case ARGPARSER_ACTION_STORE:
+			return true;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+extern struct argparser_argument *argument_index_find_positional(argparser_t argparser, const uint64_t *seen) {
+	struct argument_index *index = &argparser->index;
+	if (is_stale(argparser)) {
+		try(argument_index_build(argparser), 1, fail);
+	}
+	stats_add(argparser, lookups, 1);
+	for (size_t i = 0; i < index->positionals_number; i++) {
+		if (!bitset_test(seen, index->positionals[i])) {
+			return &argparser->arguments[index->positionals[i]];
+		}
+	}
+fail:
+	return nullptr;
+}
+
+/*
+ * Long flags and the other destination names are separate key spaces sharing
+ * the slots: a long flag lookup passes over the positionals and short-only
+ * flags with the same name, any other lookup takes the first registered.
+ */
+static const struct argument_hot *argument_index_probe(argparser_t argparser,
+                                                       const char *key,
+                                                       size_t key_len,
+                                                       bool fold_dest,
+                                                       bool is_long_flag) {
+	struct argument_index *index = &argparser->index;
+	uint32_t hash = hash_key(key, key_len);
+	char first = key_len ? key[0] : '\0';
+	size_t mask;
+	if (is_stale(argparser)) {
+		try(argument_index_build(argparser), 1, fail);
+	}
+	stats_add(argparser, lookups, 1);
+	mask = index->capacity - 1;
+	if (fold_dest) {
+		first = fold_char(first);
+	}
+	for (size_t i = hash & mask; index->slots[i].position; i = (i + 1) & mask) {
+		const struct argument_hot *hot = &index->slots[i];
+		// Only a slot agreeing on every hot field costs a read of the definition.
+		if (hot->key_hash != hash || hot->key_length != (uint32_t)key_len ||
+		    (fold_dest ? fold_char(hot->key_first) : hot->key_first) != first ||
+		    (is_long_flag && !(hot->kind & ARGUMENT_KIND_LONG_FLAG))) {
+			continue;
+		}
+		stats_add(argparser, string_comparisons, 1);
+		if (key_equals(key, key_len, get_argument_key(&argparser->arguments[hot->position - 1]), fold_dest)) {
+			return hot;
+		}
+	}
+fail:
+	return nullptr;
+}
+
+/*
+ * Look an option up in the indexes of the parents, which are built once and
+ * shared by all their children. Their help options are never inherited.
+ */
+static struct argparser_argument *find_in_parents(argparser_t argparser, const char *key, size_t key_len, char c) {
+	for (size_t i = 0; i < argparser->parents_number; i++) {
+		struct argparser_argument *argument = key ? argument_index_find_long(argparser->parents[i], key, key_len) :
+		                                            argument_index_find_short(argparser->parents[i], c);
+		if (argument && argument->action != ARGPARSER_ACTION_HELP) {
+			return argument;
+		}
+	}
+	return nullptr;
+}
+
+static int argument_index_build(argparser_t argparser) {
+	struct argument_index *index = &argparser->index;
+	size_t capacity = 8;
+	size_t positionals_number = 0;
+	struct argument_hot *slots;
+	uint32_t *positionals;
+	struct length_buckets long_flags;
+	struct length_buckets subcommands;
+	while (capacity < argparser->arguments_number * 2) {
+		capacity *= 2;
+	}
+	try(slots = calloc(capacity, sizeof *slots), nullptr, fail);
+	try(positionals = malloc((argparser->arguments_number + 1) * sizeof *positionals), nullptr, fail2);
+	stats_count_allocation(argparser, capacity * sizeof *slots);
+	stats_count_allocation(argparser, (argparser->arguments_number + 1) * sizeof *positionals);
+	memset(index->short_flags, 0, sizeof index->short_flags);
+	for (size_t i = 0; i < argparser->arguments_number; i++) {
+		const struct argparser_argument *argument = &argparser->arguments[i];
+		const char *key = get_argument_key(argument);
+		const char *flag = argument->flag;
+		struct argument_hot hot;
+		size_t key_len;
+		size_t j;
+		bool is_duplicate = false;
+		if (argument->name) {
+			positionals[positionals_number++] = (uint32_t)i;
+		}
+		if (!argument->name && flag && (unsigned char)*flag < SHORT_FLAGS_NUMBER &&
+		    !index->short_flags[(unsigned char)*flag]) {
+			index->short_flags[(unsigned char)*flag] = (uint32_t)(i + 1);
+		}
+		if (key == nullptr) {
+			continue;
+		}
+		key_len = strlen(key);
+		hot = (struct argument_hot){
+			.key_hash = hash_key(key, key_len),
+			.key_length = (uint32_t)key_len,
+			.position = (uint32_t)(i + 1),
+			.kind = argument->name ? ARGUMENT_KIND_POSITIONAL :
+			        argument->long_flag ? ARGUMENT_KIND_LONG_FLAG : 0,
+			.key_first = key[0],
+		};
+		j = hot.key_hash & (capacity - 1);
+		while (slots[j].position) {
+			if (slots[j].key_hash == hot.key_hash && slots[j].key_length == hot.key_length &&
+			    (slots[j].kind & ARGUMENT_KIND_LONG_FLAG) == (hot.kind & ARGUMENT_KIND_LONG_FLAG) &&
+			    key_equals(key, key_len, get_argument_key(&argparser->arguments[slots[j].position - 1]), false)) {
+				is_duplicate = true;
+				break;
+			}
+			j = (j + 1) & (capacity - 1);
+		}
+		// The first registered argument of each key space wins, as in a linear scan.
+		if (!is_duplicate) {
+			slots[j] = hot;
+		}
+	}
+	try(length_buckets_build(argparser, &long_flags, argparser->arguments_number, long_flag_at), 1, fail3);
+	try(length_buckets_build(argparser, &subcommands, argparser->subparsers_number, command_name_at), 1, fail4);
+	free(index->slots);
+	free(index->positionals);
+	free(index->long_flags.items);
+	free(index->subcommands.items);
+	index->slots = slots;
+	index->long_flags = long_flags;
+	index->subcommands = subcommands;
+	index->subparsers_number = argparser->subparsers_number;
+	index->capacity = capacity;
+	index->positionals = positionals;
+	index->positionals_number = positionals_number;
+	index->arguments_number = argparser->arguments_number;
+	return 0;
+fail4:
+	free(long_flags.items);
+fail3:
+	free(positionals);
+fail2:
+	free(slots);
+fail:
+	return 1;
+}
+
+/*
+ * Counting sort of the keys by length: the keys are counted per length, the
+ * counts are summed into the start of every bucket and the keys are placed
+ * front to back, which keeps them in registration order within a bucket.
+ */
+static int length_buckets_build(argparser_t argparser,
+                                struct length_buckets *buckets,
+                                size_t keys_number,
+                                const char *(*key_at)(argparser_t argparser, size_t i)) {
+	size_t buckets_number = 0;
+	size_t items_number = 0;
+	size_t size;
+	struct length_item *items;
+	uint32_t *offsets;
+	*buckets = (struct length_buckets){ 0 };
+	for (size_t i = 0; i < keys_number; i++) {
+		size_t length = key_length(key_at(argparser, i));
+		if (length <= SUGGEST_MAX_CANDIDATE_LENGTH) {
+			buckets_number = (length + 1 > buckets_number) ? length + 1 : buckets_number;
+			items_number++;
+		}
+	}
+	if (items_number == 0) {
+		return 0;
+	}
+	// The offsets follow the items in the same allocation.
+	size = items_number * sizeof *items + (buckets_number + 1) * sizeof *offsets;
+	try(items = calloc(1, size), nullptr, fail);
+	stats_count_allocation(argparser, size);
+	offsets = (uint32_t *)(items + items_number);
+	for (size_t i = 0; i < keys_number; i++) {
+		size_t length = key_length(key_at(argparser, i));
+		if (length <= SUGGEST_MAX_CANDIDATE_LENGTH) {
+			offsets[length + 1]++;
+		}
+	}
+	for (size_t l = 0; l < buckets_number; l++) {
+		offsets[l + 1] += offsets[l];
+	}
+	for (size_t i = 0; i < keys_number; i++) {
+		const char *key = key_at(argparser, i);
+		size_t length = key_length(key);
+		if (length <= SUGGEST_MAX_CANDIDATE_LENGTH) {
+			items[offsets[length]++] = (struct length_item){ .key = key, .position = (uint32_t)i };
+		}
+	}
+	// Placing moved the start of every bucket to the start of the next one.
+	memmove(offsets + 1, offsets, buckets_number * sizeof *offsets);
+	offsets[0] = 0;
+	*buckets = (struct length_buckets){
+		.buckets_number = buckets_number,
+		.offsets = offsets,
+		.items = items,
+	};
+	return 0;
+fail:
+	return 1;
+}
+
+/* The length of key or SIZE_MAX, without reading past the longest candidate. */
+static inline size_t key_length(const char *key) {
+	return key ? strnlen(key, SUGGEST_MAX_CANDIDATE_LENGTH + 1) : SIZE_MAX;
+}
+
+static const char *long_flag_at(argparser_t argparser, size_t i) {
+	return argparser->arguments[i].name ? nullptr : argparser->arguments[i].long_flag;
+}
+
+static const char *command_name_at(argparser_t argparser, size_t i) {
+	return argparser->subparsers[i].command_name;
+}
+
+static inline bool is_stale(argparser_t argparser) {
+	const struct argument_index *index = &argparser->index;
+	return index->arguments_number != argparser->arguments_number ||
+	       index->subparsers_number != argparser->subparsers_number || index->slots == nullptr;
+}
+
+static inline const char *get_argument_key(const struct argparser_argument *argument) {
+	if (argument->name) {
+		return argument->name;
+	}
+	return argument->long_flag ? argument->long_flag : argument->flag;
+}
+
+/* FNV-1a, with '_' folded to '-' so that destination names hash as flags. */
+static inline uint32_t hash_key(const char *key, size_t key_len) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < key_len; i++) {
+		hash ^= (unsigned char)fold_char(key[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static inline bool key_equals(const char *key, size_t key_len, const char *str, bool fold_dest) {
+	for (size_t i = 0; i < key_len; i++) {
+		char c = key[i];
+		char s = str[i];
+		if (s == '\0') {
+			return false;
+		}
+		if (fold_dest) {
+			c = fold_char(c);
+			s = fold_char(s);
+		}
+		if (c != s) {
+			return false;
+		}
+	}
+	return str[key_len] == '\0';
+}
+
+static inline char fold_char(char c) {
+	return (c == '_') ? '-' : c;
+}
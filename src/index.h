@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "struct_argparser.h"
+
+/*
+ * Open addressing hash table mapping the destination name of every argument
+ * (the long flag of an option, the name of a positional or, failing both, the
+ * short flag) to its position in the arguments array, together with a direct
+ * table mapping short flag characters to their option.
+ * The slots hold the hash, length and kind of every key so that a lookup
+ * reads the definition of an argument only to confirm a match.
+ * The long flags and subcommand names are also grouped by length, for the
+ * suggestions made on errors.
+ * The tables are rebuilt lazily whenever new arguments or subparsers have
+ * been registered.
+ */
+
+extern void argument_index_destroy(struct argument_index *index);
+
+/**
+ * @brief Get the index of argparser, building it if needed.
+ *
+ * @return the index or nullptr if it could not be built.
+ */
+extern const struct argument_index *argument_index_get(argparser_t argparser);
+
+/**
+ * @brief Find the argument whose destination name is equal to key.
+ *
+ * @param argparser the argument parser object.
+ * @param key the key to look for, it does not need to be nullptr terminated.
+ * @param key_len the number of bytes of key.
+ * @param fold_dest if true the characters '-' and '_' are considered equal,
+ * allowing keys written in the destination form (e.g. max_count for a
+ * --max-count option).
+ * @return the matching argument or nullptr if none exists or if the index
+ * could not be built.
+ */
+extern struct argparser_argument *argument_index_find(argparser_t argparser,
+                                                      const char *key,
+                                                      size_t key_len,
+                                                      bool fold_dest);
+
+/**
+ * @brief Find the option whose short flag is the character c.
+ *
+ * @return the matching argument or nullptr if none exists or if the index
+ * could not be built.
+ */
+extern struct argparser_argument *argument_index_find_short(argparser_t argparser, char c);
+
+/**
+ * @brief Tell whether every flag of a cluster of short flags (e.g. vxf for
+ * -vxf) can be applied.
+ *
+ * @details The flags are checked up to the first one taking a value, the
+ * rest of the cluster being its value.
+ */
+extern bool argument_index_is_cluster(argparser_t argparser, const char *cluster);
+
+/**
+ * @brief Find the option whose long flag is equal to key.
+ *
+ * @details Positionals and short-only flags with the same destination name
+ * are never matched.
+ *
+ * @return the matching argument or nullptr if none exists or if the index
+ * could not be built.
+ */
+extern struct argparser_argument *argument_index_find_long(argparser_t argparser, const char *key, size_t key_len);
+
+/**
+ * @brief Find the first positional argument not in the seen bitset.
+ *
+ * @return the matching argument or nullptr if none exists or if the index
+ * could not be built.
+ */
+extern struct argparser_argument *argument_index_find_positional(argparser_t argparser, const uint64_t *seen);
@@ -5,56 +5,139 @@
 #include <string.h>
 
 #include "buracchi/common/utilities/try.h"
-#include <buracchi/common/utilities/strto.h>
 #include <buracchi/common/utilities/utilities.h>
 
+#include "config.h"
+#include "constraints.h"
+#include "defaults.h"
+#include "index.h"
+#include "pool.h"
+#include "stats.h"
 #include "struct_argparser.h"
+#include "suggest.h"
+#include "trace.h"
 #include "utils.h"
+#include "values.h"
 
-static int parse_arg_n(argparser_t this,
-                       size_t argc,
-                       char *const *argv,
-                       struct argparser_argument **argv_argument_links,
-                       size_t n);
+/*
+ * The tokens come either from an argv array or from a buffer of NUL
+ * terminated strings, which is walked in place instead of being split into an
+ * array first.
+ */
+struct token_source {
+	char *const *argv;      /* nullptr when walking a buffer */
+	size_t argc;
+	const char *buffer;
+	const char *buffer_end;
+};
+
+/* A token collected for the positionals and its position. */
+struct positional_token {
+	const char *token;
+	size_t n;
+};
+
+/*
+ * Tokens are consumed left to right, each step parses the token at position n
+ * and sets next to the position of the first token it did not consume.
+ * Only the current token and the one after it are ever looked at.
+ */
+struct parse_state {
+	struct token_source source; /* the tokens after lookahead */
+	const char *token;          /* the token at position n, nullptr at the end */
+	const char *lookahead;      /* the token at position n + 1 or nullptr */
+	size_t n;
+	size_t next;
+	bool is_terminated;       /* an options terminator (--) has been seen */
+	size_t positionals_left;
+	bool is_deferring_positionals; /* some positional takes a variable number of tokens */
+	size_t positionals_minimum;    /* tokens the positionals need at least */
+	struct positional_token *positional_tokens; /* collected while deferring */
+	size_t positional_tokens_number;
+	size_t positional_tokens_capacity;
+	uint64_t *seen;           /* bitset of the arguments given on the command line */
+	char **leftovers;         /* unrecognized tokens, in order */
+	size_t leftovers_number;
+	size_t leftovers_capacity;
+	const struct argparser_limits *limits; /* of the parser the parse started from */
+	struct argparser_limit_error *limit_error;
+	struct argparser_constraint_error *constraint_error;
+	size_t depth;             /* number of enclosing subcommands */
+	size_t first_index;       /* position of token 0 in the whole command line */
+	size_t scratch_bytes;     /* allocated by this parse and the enclosing ones */
+	void *record;             /* the record the values are stored in, if any */
+};
+
+static int parse_tokens(argparser_t argparser,
+                        struct token_source source,
+                        char **leftovers,
+                        size_t *leftovers_number,
+                        size_t *first_operand,
+                        void *record,
+                        const struct parse_state *parent);
+
+static int check_token_limits(const struct parse_state *state);
+
+static int reserve_scratch(struct parse_state *state, size_t size);
+
+static int limit_exceeded(const struct parse_state *state, enum argparser_limit limit, size_t maximum, size_t n);
+
+static const char *token_source_next(struct token_source *source);
+
+static struct token_source token_source_rest(const struct parse_state *state);
+
+static void advance(struct parse_state *state);
+
+static int add_leftover(argparser_t argparser, struct parse_state *state, const char *token);
+
+static int add_positional_token(argparser_t argparser, struct parse_state *state);
+
+static int allocate_positionals(argparser_t argparser, struct parse_state *state);
+
+static void nargs_range(const struct argparser_argument *argument, size_t *minimum, size_t *maximum);
+
+static bool is_list(const struct argparser_argument *argument);
+
+static bool is_required_positional(const struct argparser_argument *argument);
+
+static int parse_arg_n(argparser_t this, struct parse_state *state);
 
 static struct argparser_argument *match_arg(argparser_t this,
-                                            size_t argc,
-                                            const char *args,
-                                            struct argparser_argument **argv_argument_links);
+                                            const struct parse_state *state,
+                                            const char **explicit_value);
 
 static int parse_action_store(argparser_t this,
-                              size_t argc,
-                              char *const *argv,
-                              struct argparser_argument **argv_argument_links,
-                              size_t n,
-                              struct argparser_argument *argument);
+                              struct parse_state *state,
+                              struct argparser_argument *argument,
+                              const char *attached_value);
 
 static int parse_action_store_const(argparser_t this,
-                                    size_t argc,
-                                    char *const *argv,
-                                    struct argparser_argument **argv_argument_links,
-                                    size_t n,
+                                    struct parse_state *state,
                                     struct argparser_argument *argument);
 
+static int parse_action_count(argparser_t this, struct parse_state *state, struct argparser_argument *argument);
+
 static int parse_action_help(argparser_t argparser);
 
-static int handle_unrecognized_elements(argparser_t argparser,
-                                        size_t argc,
-                                        char *const *argv,
-                                        struct argparser_argument **argv_argument_links);
+static int handle_unrecognized_elements(argparser_t argparser, size_t argc, char *const *argv);
 
-static int handle_required_missing_elements(argparser_t argparser,
-                                            size_t argc,
-                                            struct argparser_argument **argv_argument_links,
-                                            bool subcommand_parsed);
+static int handle_config_elements(argparser_t this, const uint64_t *seen, bool *configured, void *record);
 
-static int handle_optional_missing_elements(argparser_t this,
-                                            size_t argc,
-                                            struct argparser_argument **argv_argument_links);
+static int handle_required_missing_elements(argparser_t argparser,
+                                            const uint64_t *seen,
+                                            const bool *configured,
+                                            bool subcommand_parsed,
+                                            bool is_options_only);
 
 static void convert_result(argparser_t argparser,
                            struct argparser_argument *argument,
-                           const char *arg);
+                           void *destination,
+                           const char *arg,
+                           size_t n);
+
+static void handle_constraint_violation(argparser_t argparser, const struct argparser_constraint_error *error);
+
+static void print_argument_name(argparser_t argparser, const struct argparser_argument *argument);
 
 struct argv {
 	const char *ptr;
@@ -71,50 +154,178 @@ extern int argparser_parse_args1(argparser_t argparser) {
 }
 
 extern int argparser_parse_args3(argparser_t argparser, const char *args[const], size_t args_size) {
-	struct argparser_argument **arg_argument_relationships = nullptr;
-	size_t positional_params_number = 0;
-	size_t positional_params_left;
+	struct token_source source = { .argv = (char *const *)args, .argc = args_size };
+	return parse_tokens(argparser, source, nullptr, nullptr, nullptr, nullptr, nullptr);
+}
+
+extern int argparser_parse_options(argparser_t argparser,
+                                   const char *args[const],
+                                   size_t args_size,
+                                   size_t *first_operand) {
+	struct token_source source = { .argv = (char *const *)args, .argc = args_size };
+	return parse_tokens(argparser, source, nullptr, nullptr, first_operand, nullptr, nullptr);
+}
+
+extern int argparser_parse_known_args(argparser_t argparser,
+                                      const char *args[const],
+                                      size_t args_size,
+                                      char **leftovers,
+                                      size_t *leftovers_number) {
+	struct token_source source = { .argv = (char *const *)args, .argc = args_size };
+	return parse_tokens(argparser, source, leftovers, leftovers_number, nullptr, nullptr, nullptr);
+}
+
+extern int argparser_parse_buffer(argparser_t argparser, const char *buffer, size_t length) {
+	struct token_source source = { .buffer = buffer, .buffer_end = buffer + length };
+	if (length && buffer[length - 1] != '\0') {
+		return 1;
+	}
+	return parse_tokens(argparser, source, nullptr, nullptr, nullptr, nullptr, nullptr);
+}
+
+extern int argparser_parse_record(argparser_t argparser, const char *args[const], size_t args_size, void *record) {
+	struct token_source source = { .argv = (char *const *)args, .argc = args_size };
+	if (!argparser->is_record || record == nullptr) {
+		return 1;
+	}
+	return parse_tokens(argparser, source, nullptr, nullptr, nullptr, record, nullptr);
+}
+
+/*
+ * Without a leftovers array unrecognized tokens are collected in a temporary
+ * one, grown only when needed, and reported as an error once every token has
+ * been examined.
+ * With first_operand the parse stops at the first token that is not an option
+ * and stores its position, the tokens that follow are never looked at.
+ * The parse of a subcommand runs with the limits of the parse that started
+ * from the top level parser, given as parent.
+ * With a record the destinations of the arguments are offsets in it.
+ */
+static int parse_tokens(argparser_t argparser,
+                        struct token_source source,
+                        char **leftovers,
+                        size_t *leftovers_number,
+                        size_t *first_operand,
+                        void *record,
+                        const struct parse_state *parent) {
+	struct parse_state state = {
+		.source = source,
+		.leftovers = leftovers,
+		.leftovers_capacity = leftovers ? SIZE_MAX : 0,
+		.limits = parent ? parent->limits : &argparser->limits,
+		.limit_error = parent ? parent->limit_error : &argparser->limit_error,
+		.constraint_error = parent ? parent->constraint_error : &argparser->constraint_error,
+		.depth = parent ? parent->depth + 1 : 0,
+		.first_index = parent ? parent->first_index + parent->n + 1 : 0,
+		.scratch_bytes = parent ? parent->scratch_bytes : 0,
+		.record = record,
+	};
+	bool *configured = nullptr;
 	bool subcommand_parsed = false;
-	try(arg_argument_relationships = malloc(args_size * sizeof *arg_argument_relationships),
-	    nullptr,
-	    fail);
-	for (size_t i = 0; i < args_size; i++) {
-		arg_argument_relationships[i] = nullptr;
+	size_t seen_words;
+	enum argparser_phase previous_phase;
+	previous_phase = stats_enter_phase(argparser, ARGPARSER_PHASE_MATCH);
+	if (argparser->is_record && record == nullptr) {
+		goto fail;
+	}
+	if (parent == nullptr) {
+		*state.limit_error = (struct argparser_limit_error){ .limit = ARGPARSER_LIMIT_NONE };
+		*state.constraint_error = (struct argparser_constraint_error){ .constraint = ARGPARSER_CONSTRAINT_NONE };
+		try(check_token_limits(&state), 1, fail);
 	}
+	stats_enter_phase(argparser, ARGPARSER_PHASE_DEFAULTS);
+	try(defaults_image_apply(argparser, record), 1, fail);
+	for (size_t i = 0; i < argparser->parents_number; i++) {
+		try(defaults_image_apply(argparser->parents[i], record), 1, fail);
+	}
+	stats_enter_phase(argparser, ARGPARSER_PHASE_MATCH);
+	seen_words = BITSET_WORDS(arguments_total(argparser));
+	try(reserve_scratch(&state, seen_words * sizeof *state.seen), 1, fail);
+	try(state.seen = calloc(seen_words, sizeof *state.seen), nullptr, fail);
+	stats_count_allocation(argparser, seen_words * sizeof *state.seen);
 	for (size_t i = 0; i < argparser->arguments_number; i++) {
 		if (argparser->arguments[i].name) {
-			positional_params_number++;
+			size_t minimum;
+			size_t maximum;
+			nargs_range(&argparser->arguments[i], &minimum, &maximum);
+			state.positionals_left++;
+			state.positionals_minimum += minimum;
+			if (argparser->arguments[i].action_nargs != ARGPARSER_ACTION_NARGS_SINGLE) {
+				state.is_deferring_positionals = true;
+			}
 		}
 	}
-	positional_params_left = positional_params_number;
-	for (size_t i = 0; i < args_size; i++) {
-		bool is_arg_parsed = arg_argument_relationships[i];
-		if (is_arg_parsed) {
+	state.token = token_source_next(&state.source);
+	state.lookahead = token_source_next(&state.source);
+	while (state.token) {
+		const char *token = state.token;
+		bool is_option = !state.is_terminated && is_prefix_char(argparser, token[0]);
+		size_t leftovers_before = state.leftovers_number;
+		if (first_operand && !is_option) {
+			break;
+		}
+		if (is_option && strcmp(token, argparser->long_prefix) == 0) {
+			stats_add(argparser, tokens, 1);
+			state.is_terminated = true;
+			advance(&state);
 			continue;
 		}
-		if (positional_params_left == 0) {
+		if (!is_option && !state.is_terminated &&
+		    (state.is_deferring_positionals ? state.positional_tokens_number >= state.positionals_minimum :
+		                                      state.positionals_left == 0)) {
 			for (size_t j = 0; j < argparser->subparsers_number; j++) {
-				if (!strcmp(args[i], argparser->subparsers[j].command_name)) {
-					*(argparser->subparsers[j].selection_result) =
-						args[i];
-					argparser_parse_args3(
-						argparser->subparsers[j].parser,
-						args + i + 1,
-						args_size - i - 1);
-					args_size = i;
+				stats_add(argparser, string_comparisons, 1);
+				if (!strcmp(token, argparser->subparsers[j].command_name)) {
+					size_t subparser_leftovers_number = 0;
+					if (state.limits->max_subcommand_depth &&
+					    state.depth == state.limits->max_subcommand_depth) {
+						limit_exceeded(&state,
+						               ARGPARSER_LIMIT_SUBCOMMAND_DEPTH,
+						               state.limits->max_subcommand_depth,
+						               state.n);
+						goto fail2;
+					}
+					stats_add(argparser, tokens, 1);
+					stats_add(argparser, subcommand_hops, 1);
+					trace(argparser, state.n, token, ARGPARSER_TRACE_SUBCOMMAND, nullptr);
+					*(argparser->subparsers[j].selection_result) = token;
+					try(parse_tokens(argparser->subparsers[j].parser,
+					                 token_source_rest(&state),
+					                 leftovers ? leftovers + state.leftovers_number : nullptr,
+					                 &subparser_leftovers_number,
+					                 nullptr,
+					                 record,
+					                 &state),
+					    1,
+					    fail2);
+					state.leftovers_number += subparser_leftovers_number;
 					subcommand_parsed = true;
 					goto end;
 				}
 			}
 		}
-		if (parse_arg_n(argparser, args_size, args, arg_argument_relationships, i)) {
+		if (state.is_deferring_positionals && !is_option) {
+			stats_add(argparser, tokens, 1);
+			try(add_positional_token(argparser, &state), 1, fail2);
+			advance(&state);
+			continue;
+		}
+		if (parse_arg_n(argparser, &state)) {
+			// The remaining tokens are unrecognized.
+			while (state.token) {
+				stats_add(argparser, tokens, 1);
+				try(add_leftover(argparser, &state, state.token), 1, fail2);
+				advance(&state);
+			}
 			break;
 		}
-		if (arg_argument_relationships[i] &&
-		    arg_argument_relationships[i]->name) {
-			positional_params_left--;
+		stats_add(argparser, tokens, state.next - state.n);
+		while (state.n < state.next) {
+			advance(&state);
 		}
-		if (positional_params_left == 0 && arg_argument_relationships[i] == nullptr) {
+		if (state.leftovers_number > leftovers_before && state.positionals_left == 0 &&
+		    argparser->subparsers_number && !is_option && !state.is_terminated) {
+			const char *suggestion = suggest_subcommand(argparser, token);
 			argparser_print_usage(argparser);
 			printf("%s: error: argument {", argparser->program_name);
 			for (size_t j = 0; j < argparser->subparsers_number; j++) {
@@ -122,7 +333,11 @@ extern int argparser_parse_args3(argparser_t argparser, const char *args[const],
 				       argparser->subparsers[j].command_name,
 				       (j < argparser->subparsers_number - 1) ? "," : "");
 			}
-			printf("}: invalid choice: '%s' (choose from ", args[i]);
+			printf("}: invalid choice: '%s'", token);
+			if (suggestion) {
+				printf(", maybe you meant '%s'?", suggestion);
+			}
+			printf(" (choose from ");
 			for (size_t j = 0; j < argparser->subparsers_number; j++) {
 				printf("'%s'%s",
 				       argparser->subparsers[j].command_name,
@@ -133,96 +348,456 @@ extern int argparser_parse_args3(argparser_t argparser, const char *args[const],
 		}
 	}
 end:
-	handle_unrecognized_elements(argparser, args_size, args, arg_argument_relationships);
-	handle_required_missing_elements(argparser, args_size, arg_argument_relationships, subcommand_parsed);
-	handle_optional_missing_elements(argparser, args_size, arg_argument_relationships);
-	free(arg_argument_relationships);
+	if (first_operand) {
+		*first_operand = state.n;
+	}
+	if (state.is_deferring_positionals && first_operand == nullptr) {
+		try(allocate_positionals(argparser, &state), 1, fail2);
+	}
+	if (leftovers == nullptr) {
+		handle_unrecognized_elements(argparser, state.leftovers_number, state.leftovers);
+	}
+	else {
+		leftovers[state.leftovers_number] = nullptr;
+		*leftovers_number = state.leftovers_number;
+	}
+	stats_enter_phase(argparser, ARGPARSER_PHASE_REQUIRED);
+	if (constraints_check(argparser, state.seen, state.constraint_error)) {
+		if (state.constraint_error->constraint == ARGPARSER_CONSTRAINT_NONE) {
+			goto fail2;
+		}
+		handle_constraint_violation(argparser, state.constraint_error);
+	}
+	if (argparser->config) {
+		stats_enter_phase(argparser, ARGPARSER_PHASE_DEFAULTS);
+		try(reserve_scratch(&state, argparser->arguments_number * sizeof *configured), 1, fail2);
+		try(configured = calloc(argparser->arguments_number, sizeof *configured), nullptr, fail2);
+		stats_count_allocation(argparser, argparser->arguments_number * sizeof *configured);
+		if (argparser->is_config_reload_enabled) {
+			try(config_reload_prepare(argparser, state.seen), 1, fail3);
+		}
+		handle_config_elements(argparser, state.seen, configured, record);
+	}
+	stats_enter_phase(argparser, ARGPARSER_PHASE_REQUIRED);
+	handle_required_missing_elements(argparser,
+	                                 state.seen,
+	                                 configured,
+	                                 subcommand_parsed,
+	                                 first_operand != nullptr);
+	if (argparser->config && argparser->is_config_reload_enabled) {
+		config_reload_publish(argparser);
+	}
+	free(configured);
+	free(state.positional_tokens);
+	free(state.seen);
+	if (leftovers == nullptr) {
+		free(state.leftovers);
+	}
+	stats_enter_phase(argparser, previous_phase);
 	return 0;
+fail3:
+	free(configured);
+fail2:
+	if (leftovers == nullptr) {
+		free(state.leftovers);
+	}
+	free(state.positional_tokens);
+	free(state.seen);
 fail:
+	stats_enter_phase(argparser, previous_phase);
+	return 1;
+}
+
+/*
+ * The tokens are measured before anything is allocated. The length of an argv
+ * token is only read up to the first byte past the limits, a buffer has
+ * already been bounded as a whole.
+ */
+static int check_token_limits(const struct parse_state *state) {
+	const struct argparser_limits *limits = state->limits;
+	struct token_source source = state->source;
+	size_t total_bytes = 0;
+	size_t n = 0;
+	const char *token;
+	if (limits->max_tokens && source.argv && source.argc > limits->max_tokens) {
+		return limit_exceeded(state, ARGPARSER_LIMIT_TOKENS, limits->max_tokens, limits->max_tokens);
+	}
+	if (limits->max_total_bytes && source.argv == nullptr &&
+	    (size_t)(source.buffer_end - source.buffer) > limits->max_total_bytes) {
+		return limit_exceeded(state, ARGPARSER_LIMIT_TOTAL_BYTES, limits->max_total_bytes, 0);
+	}
+	if (!limits->max_token_length && !(limits->max_total_bytes && source.argv) &&
+	    !(limits->max_tokens && source.argv == nullptr)) {
+		return 0;
+	}
+	for (; (token = token_source_next(&source)); n++) {
+		size_t bound = SIZE_MAX;
+		size_t length;
+		if (limits->max_tokens && n == limits->max_tokens) {
+			return limit_exceeded(state, ARGPARSER_LIMIT_TOKENS, limits->max_tokens, n);
+		}
+		if (limits->max_token_length) {
+			bound = limits->max_token_length + 1;
+		}
+		if (limits->max_total_bytes && limits->max_total_bytes - total_bytes < bound) {
+			bound = limits->max_total_bytes - total_bytes;
+		}
+		length = strnlen(token, bound);
+		if (limits->max_token_length && length > limits->max_token_length) {
+			return limit_exceeded(state, ARGPARSER_LIMIT_TOKEN_LENGTH, limits->max_token_length, n);
+		}
+		total_bytes += length + 1;
+		if (limits->max_total_bytes && total_bytes > limits->max_total_bytes) {
+			return limit_exceeded(state, ARGPARSER_LIMIT_TOTAL_BYTES, limits->max_total_bytes, n);
+		}
+	}
+	return 0;
+}
+
+static int reserve_scratch(struct parse_state *state, size_t size) {
+	size_t maximum = state->limits->max_scratch_bytes;
+	if (maximum && size > maximum - state->scratch_bytes) {
+		return limit_exceeded(state, ARGPARSER_LIMIT_SCRATCH_BYTES, maximum, state->n);
+	}
+	state->scratch_bytes += size;
+	return 0;
+}
+
+/* Record the violation and return 1, n is relative to the tokens of state. */
+static int limit_exceeded(const struct parse_state *state, enum argparser_limit limit, size_t maximum, size_t n) {
+	*state->limit_error = (struct argparser_limit_error){
+		.limit = limit,
+		.maximum = maximum,
+		.token_index = state->first_index + n,
+	};
 	return 1;
 }
 
-static int parse_arg_n(argparser_t this,
-                       size_t argc,
-                       char *const *argv,
-                       struct argparser_argument **argv_argument_links,
-                       size_t n) {
+static const char *token_source_next(struct token_source *source) {
+	const char *token;
+	if (source->argv) {
+		if (source->argc == 0) {
+			return nullptr;
+		}
+		source->argc--;
+		return *(source->argv++);
+	}
+	if (source->buffer == source->buffer_end) {
+		return nullptr;
+	}
+	token = source->buffer;
+	source->buffer = (const char *)memchr(token, '\0', (size_t)(source->buffer_end - token)) + 1;
+	return token;
+}
+
+/* The tokens that follow the current one, e.g. the ones of a subcommand. */
+static struct token_source token_source_rest(const struct parse_state *state) {
+	struct token_source rest = state->source;
+	if (state->lookahead == nullptr) {
+		return rest;
+	}
+	if (rest.argv) {
+		rest.argv--;
+		rest.argc++;
+	}
+	else {
+		rest.buffer = state->lookahead;
+	}
+	return rest;
+}
+
+static void advance(struct parse_state *state) {
+	state->token = state->lookahead;
+	state->lookahead = token_source_next(&state->source);
+	state->n++;
+}
+
+static int parse_arg_n(argparser_t this, struct parse_state *state) {
 	struct argparser_argument *matching_arg;
-	matching_arg = match_arg(this, argc, argv[n], argv_argument_links);
-	if (matching_arg) {
+	const char *token = state->token;
+	const char *cluster = token + 1;
+	const char *explicit_value = nullptr;
+	bool is_cluster;
+	matching_arg = match_arg(this, state, &explicit_value);
+	is_cluster = matching_arg && !matching_arg->name && !is_prefix_char(this, token[1]);
+	state->next = state->n;
+	// A cluster with an unknown flag is unrecognized as a whole, none of its flags is applied.
+	if (is_cluster && cluster[1] && !argument_index_is_cluster(this, cluster)) {
+		matching_arg = nullptr;
+	}
+	/*
+	 * Short flags may be clustered (e.g. -vxf file): flags without a value
+	 * are walked one character at a time, a flag taking a value consumes
+	 * the rest of the token or, if nothing is left, the next one.
+	 * A long flag takes the value following '=' (e.g. --name=joe).
+	 */
+	while (true) {
+		const char *attached_value = is_cluster ? (cluster[1] ? cluster + 1 : nullptr) : explicit_value;
+		int result;
+		trace(this, state->n, token, matching_arg ? ARGPARSER_TRACE_MATCH : ARGPARSER_TRACE_NO_MATCH, matching_arg);
+		if (matching_arg == nullptr || (explicit_value && matching_arg->action != ARGPARSER_ACTION_STORE)) {
+			break;
+		}
 		switch (matching_arg->action) {
 		case ARGPARSER_ACTION_HELP:
 			return parse_action_help(this);
 		case ARGPARSER_ACTION_STORE:
-			return parse_action_store(this, argc, argv, argv_argument_links, n, matching_arg);
+			result = parse_action_store(this, state, matching_arg, attached_value);
+			break;
 		case ARGPARSER_ACTION_STORE_CONST:
-			return parse_action_store_const(this, argc, argv, argv_argument_links, n, matching_arg);
+			result = parse_action_store_const(this, state, matching_arg);
+			break;
+		case ARGPARSER_ACTION_COUNT:
+			result = parse_action_count(this, state, matching_arg);
+			break;
 		case ARGPARSER_ACTION_APPEND:
 			// TODO
-			break;
 		case ARGPARSER_ACTION_APPEND_CONST:
 			// TODO
-			break;
-		case ARGPARSER_ACTION_COUNT:
-			// TODO
-			break;
 		case ARGPARSER_ACTION_EXTEND:
 			// TODO
-			break;
 		default:
+			result = 0;
+			break;
+		}
+		if (result) {
+			return result;
+		}
+		if (state->next == state->n) {
 			break;
 		}
+		bitset_set(state->seen, argument_position(this, matching_arg));
+		if (matching_arg->name) {
+			state->positionals_left--;
+		}
+		if (attached_value == nullptr || matching_arg->action == ARGPARSER_ACTION_STORE) {
+			return 0;
+		}
+		cluster++;
+		matching_arg = argument_index_find_short(this, *cluster);
 	}
+	state->next = state->n + 1;
+	return add_leftover(this, state, token);
+}
+
+static int add_leftover(argparser_t argparser, struct parse_state *state, const char *token) {
+	if (state->leftovers_number == state->leftovers_capacity) {
+		size_t capacity = state->leftovers_capacity ? state->leftovers_capacity * 2 : 8;
+		char **leftovers;
+		try(reserve_scratch(state, (capacity - state->leftovers_capacity) * sizeof *leftovers), 1, fail);
+		try(leftovers = realloc(state->leftovers, capacity * sizeof *leftovers), nullptr, fail);
+		stats_count_allocation(argparser, capacity * sizeof *leftovers);
+		state->leftovers = leftovers;
+		state->leftovers_capacity = capacity;
+	}
+	state->leftovers[state->leftovers_number++] = (char *)token;
 	return 0;
+fail:
+	return 1;
 }
 
-static struct argparser_argument *match_arg(argparser_t this,
-                                            size_t argc,
-                                            const char *args,
-                                            struct argparser_argument **argv_argument_links) {
-	bool match_positional = (args[0] != '-');
-	bool match_optional = !match_positional && args[1];
-	bool match_long_flag = match_optional && (args[1] == '-') && args[2];
-	for (size_t i = 0; i < this->arguments_number; i++) {
-		bool is_argument_parsed = false;
-		for (size_t j = 0; j < argc; j++) {
-			if (argv_argument_links[j] == &(this->arguments[i])) {
-				is_argument_parsed = true;
-				break;
-			}
+static int add_positional_token(argparser_t argparser, struct parse_state *state) {
+	if (state->positional_tokens_number == state->positional_tokens_capacity) {
+		size_t capacity = state->positional_tokens_capacity ? state->positional_tokens_capacity * 2 : 8;
+		struct positional_token *tokens;
+		try(reserve_scratch(state, (capacity - state->positional_tokens_capacity) * sizeof *tokens), 1, fail);
+		try(tokens = realloc(state->positional_tokens, capacity * sizeof *tokens), nullptr, fail);
+		stats_count_allocation(argparser, capacity * sizeof *tokens);
+		state->positional_tokens = tokens;
+		state->positional_tokens_capacity = capacity;
+	}
+	state->positional_tokens[state->positional_tokens_number++] = (struct positional_token){
+		.token = state->token,
+		.n = state->n,
+	};
+	return 0;
+fail:
+	return 1;
+}
+
+/*
+ * The tokens collected for the positionals are split among them in a single
+ * pass. Like the greedy pattern argparse matches against the token kinds, but
+ * without backtracking, every positional takes as many tokens as it can while
+ * leaving the minimum the following ones need, e.g. "src... dst" gives all the
+ * tokens but the last to src. The tokens no positional can take are
+ * unrecognized; with too few tokens the positionals are filled in order and
+ * the ones left short are reported as missing.
+ * List values point into an array owned by the parser, each list followed by
+ * nullptr, which is replaced by the next parse. The lists of a record are
+ * taken from the pool instead, so that every record keeps its own until the
+ * parser is destroyed.
+ */
+static int allocate_positionals(argparser_t argparser, struct parse_state *state) {
+	const struct positional_token *next_token = state->positional_tokens;
+	size_t minimum_after = state->positionals_minimum;
+	size_t maximum_total = 0;
+	size_t lists_number = 0;
+	size_t remaining;
+	char **list_values = nullptr;
+	for (size_t i = 0; i < argparser->arguments_number; i++) {
+		const struct argparser_argument *argument = &argparser->arguments[i];
+		size_t minimum;
+		size_t maximum;
+		if (!argument->name) {
+			continue;
+		}
+		nargs_range(argument, &minimum, &maximum);
+		maximum_total = (maximum > SIZE_MAX - maximum_total) ? SIZE_MAX : maximum_total + maximum;
+		if (is_list(argument)) {
+			lists_number++;
 		}
-		if (is_argument_parsed) {
+	}
+	remaining = state->positional_tokens_number < maximum_total ? state->positional_tokens_number : maximum_total;
+	for (size_t i = remaining; i < state->positional_tokens_number; i++) {
+		try(add_leftover(argparser, state, state->positional_tokens[i].token), 1, fail);
+	}
+	if (lists_number && state->record) {
+		try(list_values = pool_alloc(argparser, (remaining + lists_number) * sizeof *list_values), nullptr, fail);
+	}
+	else if (lists_number) {
+		try(reserve_scratch(state, (remaining + lists_number) * sizeof *list_values), 1, fail);
+		try(list_values = malloc((remaining + lists_number) * sizeof *list_values), nullptr, fail);
+		stats_count_allocation(argparser, (remaining + lists_number) * sizeof *list_values);
+		free(argparser->positional_lists);
+		argparser->positional_lists = list_values;
+	}
+	for (size_t i = 0; i < argparser->arguments_number; i++) {
+		struct argparser_argument *argument = &argparser->arguments[i];
+		size_t minimum;
+		size_t maximum;
+		size_t count;
+		if (!argument->name) {
 			continue;
 		}
-		if ((match_positional && this->arguments[i].name) ||
-		    (match_optional && this->arguments[i].flag &&
-		     *(args + 1) == *(this->arguments[i].flag)) ||
-		    (match_long_flag && this->arguments[i].long_flag &&
-		     streq(args + 2, this->arguments[i].long_flag))) {
-			return &(this->arguments[i]);
+		nargs_range(argument, &minimum, &maximum);
+		minimum_after -= minimum;
+		if (remaining >= minimum + minimum_after) {
+			count = (maximum < remaining - minimum_after) ? maximum : remaining - minimum_after;
+		}
+		else {
+			count = (minimum < remaining) ? minimum : remaining;
+		}
+		remaining -= count;
+		if (is_list(argument)) {
+			*(char ***)argument_destination(argument, state->record) = list_values;
+			for (size_t j = 0; j < count; j++, next_token++) {
+				trace(argparser, next_token->n, next_token->token, ARGPARSER_TRACE_VALUE, argument);
+				*(list_values++) = (char *)next_token->token;
+			}
+			*(list_values++) = nullptr;
+		}
+		else if (count) {
+			convert_result(argparser,
+			               argument,
+			               argument_destination(argument, state->record),
+			               next_token->token,
+			               next_token->n);
+			next_token++;
+		}
+		if (count && count >= minimum) {
+			bitset_set(state->seen, i);
 		}
 	}
-	return nullptr;
+	return 0;
+fail:
+	return 1;
 }
 
-static int handle_unrecognized_elements(argparser_t argparser,
-                                        size_t argc,
-                                        char *const *argv,
-                                        struct argparser_argument **argv_argument_links) {
-	bool all_arguments_recognized = true;
-	for (size_t i = 0; i < argc; i++) {
-		if (argv_argument_links[i] == nullptr) {
-			all_arguments_recognized = false;
-			break;
+static bool is_list(const struct argparser_argument *argument) {
+	return argument->action_nargs == ARGPARSER_ACTION_NARGS_LIST_OF_N ||
+	       argument->action_nargs == ARGPARSER_ACTION_NARGS_LIST ||
+	       argument->action_nargs == ARGPARSER_ACTION_NARGS_LIST_OPTIONAL;
+}
+
+static bool is_required_positional(const struct argparser_argument *argument) {
+	size_t minimum;
+	size_t maximum;
+	nargs_range(argument, &minimum, &maximum);
+	return minimum > 0;
+}
+
+static void nargs_range(const struct argparser_argument *argument, size_t *minimum, size_t *maximum) {
+	switch (argument->action_nargs) {
+	case ARGPARSER_ACTION_NARGS_OPTIONAL:
+		*minimum = 0;
+		*maximum = 1;
+		break;
+	case ARGPARSER_ACTION_NARGS_LIST_OF_N:
+		*minimum = argument->nargs_list_size;
+		*maximum = argument->nargs_list_size;
+		break;
+	case ARGPARSER_ACTION_NARGS_LIST:
+		*minimum = 1;
+		*maximum = SIZE_MAX;
+		break;
+	case ARGPARSER_ACTION_NARGS_LIST_OPTIONAL:
+		*minimum = 0;
+		*maximum = SIZE_MAX;
+		break;
+	default:
+		*minimum = 1;
+		*maximum = 1;
+		break;
+	}
+}
+
+/*
+ * Options can be repeated, the last occurrence wins, positionals are matched
+ * in order of registration.
+ * A long flag followed by '=' is looked up without the value, which is
+ * returned in explicit_value pointing into the token.
+ */
+static struct argparser_argument *match_arg(argparser_t this,
+                                            const struct parse_state *state,
+                                            const char **explicit_value) {
+	const char *args = state->token;
+	bool match_positional = state->is_terminated || !is_prefix_char(this, args[0]);
+	bool match_optional = !match_positional && args[1];
+	bool match_long_flag = match_optional && is_prefix_char(this, args[1]) && args[2];
+	if (match_positional || match_optional) {
+		trace(this,
+		      state->n,
+		      args,
+		      match_positional ? ARGPARSER_TRACE_POSITIONAL :
+		      match_long_flag  ? ARGPARSER_TRACE_LONG_FLAG :
+		                         ARGPARSER_TRACE_SHORT_FLAG,
+		      nullptr);
+	}
+	if (match_long_flag) {
+		size_t length = strlen(args + 2);
+		const char *equals = memchr(args + 2, '=', length);
+		if (equals) {
+			length = (size_t)(equals - (args + 2));
+			*explicit_value = equals + 1;
 		}
+		return argument_index_find_long(this, args + 2, length);
+	}
+	if (match_optional) {
+		return argument_index_find_short(this, args[1]);
+	}
+	if (match_positional && state->positionals_left) {
+		return argument_index_find_positional(this, state->seen);
 	}
-	if (all_arguments_recognized) {
+	return nullptr;
+}
+
+static int handle_unrecognized_elements(argparser_t argparser, size_t argc, char *const *argv) {
+	if (argc == 0) {
 		return 0;
 	}
 	argparser_print_usage(argparser);
 	printf("%s: error: unrecognized arguments: ", argparser->program_name);
 	for (size_t i = 0; i < argc; i++) {
-		if (argv_argument_links[i] == nullptr) {
+		const struct argparser_argument *suggestion;
+		suggestion = is_prefix_char(argparser, argv[i][0]) ? suggest_flag(argparser, argv[i]) : nullptr;
+		if (suggestion) {
+			printf("%s (maybe you meant '%s%s'?) ",
+			       argv[i],
+			       argparser->long_prefix,
+			       suggestion->long_flag);
+		}
+		else {
 			printf("%s ", argv[i]);
 		}
 	}
@@ -231,30 +806,84 @@ static int handle_unrecognized_elements(argparser_t argparser,
 	return 0;
 }
 
+static int handle_config_elements(argparser_t this, const uint64_t *seen, bool *configured, void *record) {
+	const struct config_source *config = this->config;
+	bool all_keys_recognized = true;
+	for (size_t i = 0; i < config->entries_number; i++) {
+		const struct config_entry *entry = &config->entries[i];
+		struct argparser_argument *argument;
+		argument = argument_index_find(this, entry->key, entry->key_len, true);
+		if (argument == nullptr || argument->action == ARGPARSER_ACTION_HELP) {
+			all_keys_recognized = false;
+			break;
+		}
+	}
+	if (!all_keys_recognized) {
+		argparser_print_usage(this);
+		printf("%s: error: unrecognized keys in %s: ", this->program_name, config->path);
+		for (size_t i = 0; i < config->entries_number; i++) {
+			const struct config_entry *entry = &config->entries[i];
+			struct argparser_argument *argument;
+			argument = argument_index_find(this, entry->key, entry->key_len, true);
+			if (argument == nullptr || argument->action == ARGPARSER_ACTION_HELP) {
+				printf("'%s' (line %zu) ", entry->key, entry->line);
+			}
+		}
+		printf("\n");
+		exit(EXIT_FAILURE);
+	}
+	for (size_t i = 0; i < config->entries_number; i++) {
+		const struct config_entry *entry = &config->entries[i];
+		struct argparser_argument *argument;
+		argument = argument_index_find(this, entry->key, entry->key_len, true);
+		if (bitset_test(seen, (size_t)(argument - this->arguments))) {
+			continue;
+		}
+		if (!config_argument_is_settable(argument)) {
+			argparser_print_usage(this);
+			printf("%s: error: %s:%zu: key '%s' cannot be set in a configuration file\n",
+			       this->program_name,
+			       config->path,
+			       entry->line,
+			       entry->key);
+			exit(EXIT_FAILURE);
+		}
+		if (!config_entry_value(argument, entry, argument_destination(argument, record))) {
+			argparser_print_usage(this);
+			printf("%s: error: %s:%zu: invalid value for key '%s': '%s'\n",
+			       this->program_name,
+			       config->path,
+			       entry->line,
+			       entry->key,
+			       entry->value ? entry->value : "");
+			exit(EXIT_FAILURE);
+		}
+		configured[argument - this->arguments] = true;
+	}
+	return 0;
+}
+
+/* Positionals and subcommands are left to the caller when parsing options only. */
 static int handle_required_missing_elements(argparser_t argparser,
-                                            size_t argc,
-                                            struct argparser_argument **argv_argument_links,
-                                            bool subcommand_parsed) {
+                                            const uint64_t *seen,
+                                            const bool *configured,
+                                            bool subcommand_parsed,
+                                            bool is_options_only) {
 	bool exists_missing_required_arg = false;
 	bool is_first_missing_arg = true;
+	struct argparser_argument *argument;
+	if (is_options_only) {
+		subcommand_parsed = true;
+	}
 	if (argparser->subparsers_options.required && !subcommand_parsed) {
 		exists_missing_required_arg = true;
 	}
 	else {
-		for (size_t i = 0; i < argparser->arguments_number; i++) {
-			struct argparser_argument *argument;
-			bool is_arg_parsed = false;
-			argument = &(argparser->arguments[i]);
-			if (!argument->name && !argument->is_required) {
-				continue;
-			}
-			for (size_t j = 0; j < argc; j++) {
-				if (argument == argv_argument_links[j]) {
-					is_arg_parsed = true;
-					break;
-				}
-			}
-			if (is_arg_parsed) {
+		for (struct argument_cursor cursor = { 0 }; (argument = argument_next(argparser, &cursor));) {
+			size_t i = cursor.position;
+			if ((!argument->name && !argument->is_required) ||
+			    (argument->name && (is_options_only || !is_required_positional(argument))) ||
+			    (configured && i < argparser->arguments_number && configured[i]) || bitset_test(seen, i)) {
 				continue;
 			}
 			exists_missing_required_arg = true;
@@ -266,47 +895,29 @@ static int handle_required_missing_elements(argparser_t argparser,
 	}
 	argparser_print_usage(argparser);
 	printf("%s: error: the following arguments are required: ", argparser->program_name);
-	for (size_t i = 0; i < argparser->arguments_number; i++) {
-		struct argparser_argument *argument;
-		bool is_arg_parsed = false;
-		argument = &(argparser->arguments[i]);
-		if (!argument->name && !argument->is_required) {
-			continue;
-		}
-		for (size_t j = 0; j < argc; j++) {
-			if (argument == argv_argument_links[j]) {
-				is_arg_parsed = true;
-				break;
-			}
-		}
-		if (is_arg_parsed) {
+	for (struct argument_cursor cursor = { 0 }; (argument = argument_next(argparser, &cursor));) {
+		size_t i = cursor.position;
+		if ((!argument->name && !argument->is_required) ||
+		    (argument->name && (is_options_only || !is_required_positional(argument))) ||
+		    (configured && i < argparser->arguments_number && configured[i]) || bitset_test(seen, i)) {
 			continue;
 		}
 		if (!argument->name) {
 			printf("%s", is_first_missing_arg ? "" : ", ");
 			printf("%s%s%s%s%s",
-			       argument->flag ? "-" : "",
+			       argument->flag ? argparser->short_prefix : "",
 			       argument->flag ? argument->flag : "",
 			       argument->flag && argument->long_flag ? "/" : "",
-			       argument->long_flag ? "--" : "",
+			       argument->long_flag ? argparser->long_prefix : "",
 			       argument->long_flag ? argument->long_flag : "");
 			is_first_missing_arg = false;
 		}
 	}
 	for (size_t i = 0; i < argparser->arguments_number; i++) {
-		struct argparser_argument *argument;
-		bool is_arg_parsed = false;
 		argument = &(argparser->arguments[i]);
-		if (!argument->name && !argument->is_required) {
-			continue;
-		}
-		for (size_t j = 0; j < argc; j++) {
-			if (argument == argv_argument_links[j]) {
-				is_arg_parsed = true;
-				break;
-			}
-		}
-		if (is_arg_parsed) {
+		if ((!argument->name && !argument->is_required) ||
+		    (argument->name && (is_options_only || !is_required_positional(argument))) ||
+		    (configured && configured[i]) || bitset_test(seen, i)) {
 			continue;
 		}
 		if (argument->name) {
@@ -329,33 +940,32 @@ static int handle_required_missing_elements(argparser_t argparser,
 	return 0;
 }
 
-static int handle_optional_missing_elements(argparser_t this,
-                                            size_t argc,
-                                            struct argparser_argument **argv_argument_links) {
-	for (size_t i = 0; i < this->arguments_number; i++) {
-		struct argparser_argument *argument;
-		bool is_arg_parsed = false;
-		argument = &(this->arguments[i]);
-		if (argument->name || argument->is_required) {
-			continue;
-		}
-		for (size_t j = 0; j < argc; j++) {
-			if (argument == argv_argument_links[j]) {
-				is_arg_parsed = true;
-				break;
-			}
-		}
-		if (is_arg_parsed) {
-			continue;
-		}
-		// TODO: handle all cases
-		if (argument->action == ARGPARSER_ACTION_STORE) {
-			if (argument->type == ARGPARSER_TYPE_CSTR) {
-				*(argument->destination) = argument->default_value;
-			}
-		}
+static void handle_constraint_violation(argparser_t argparser, const struct argparser_constraint_error *error) {
+	static const char *const relations[] = {
+		[ARGPARSER_CONSTRAINT_MUTUALLY_EXCLUSIVE] = "not allowed with",
+		[ARGPARSER_CONSTRAINT_REQUIRED_TOGETHER] = "must be given together with",
+		[ARGPARSER_CONSTRAINT_REQUIRES] = "requires",
+	};
+	argparser_print_usage(argparser);
+	printf("%s: error: argument ", argparser->program_name);
+	print_argument_name(argparser, error->argument);
+	printf(": %s argument ", relations[error->constraint]);
+	print_argument_name(argparser, error->other);
+	printf("\n");
+	exit(EXIT_FAILURE);
+}
+
+static void print_argument_name(argparser_t argparser, const struct argparser_argument *argument) {
+	if (argument->name) {
+		printf("%s", argument->name);
+		return;
 	}
-	return 0;
+	printf("%s%s%s%s%s",
+	       argument->flag ? argparser->short_prefix : "",
+	       argument->flag ? argument->flag : "",
+	       argument->flag && argument->long_flag ? "/" : "",
+	       argument->long_flag ? argparser->long_prefix : "",
+	       argument->long_flag ? argument->long_flag : "");
 }
 
 static int parse_action_help(argparser_t argparser) {
@@ -365,56 +975,42 @@ static int parse_action_help(argparser_t argparser) {
 }
 
 static int parse_action_store(argparser_t this,
-                              size_t argc,
-                              char *const *argv,
-                              struct argparser_argument **argv_argument_links,
-                              size_t n,
-                              struct argparser_argument *argument) {
+                              struct parse_state *state,
+                              struct argparser_argument *argument,
+                              const char *attached_value) {
+	const char *lookahead = state->lookahead;
+	size_t n = state->n;
 	bool is_next_argv_used = false;
 	bool is_positional = argument->name;
 	switch (argument->action_nargs) {
 	case ARGPARSER_ACTION_NARGS_SINGLE:
 		{
-			char *arg;
+			const char *arg;
 			if (is_positional) {
-				arg = argv[n];
+				arg = state->token;
 			}
 			else {
-				if (strlen(argv[n]) > 2) {
-					arg = argv[n] + 2;
+				if (attached_value) {
+					arg = attached_value;
 				}
-				else if (n == argc - 1 || (!isnumber(argv[n + 1]) &&
-				                           argv[n + 1][0] == '-')) {
+				else if (lookahead == nullptr || (!isnumber(lookahead) &&
+				                                  is_prefix_char(this, lookahead[0]))) {
 					return 1;
 				}
 				else {
 					is_next_argv_used = true;
-					arg = argv[n + 1];
+					arg = lookahead;
 				}
 			}
-			switch (argument->type) {
-			case ARGPARSER_TYPE_BOOL:
-				// TODO
-				break;
-			case ARGPARSER_TYPE_CSTR:
-				*(argument->destination) = arg;
-				break;
-			case ARGPARSER_TYPE_INT:
-			case ARGPARSER_TYPE_LONG:
-			case ARGPARSER_TYPE_USHORT:
-			case ARGPARSER_TYPE_UINT:
-				convert_result(this, argument, arg);
-				break;
-			}
-			if (is_positional) {
-				argv_argument_links[n] = argument;
-			}
-			else {
-				argv_argument_links[n] = argument;
-				if (is_next_argv_used) {
-					argv_argument_links[n + 1] = argument;
-				}
+			if (is_next_argv_used) {
+				trace(this, n + 1, arg, ARGPARSER_TRACE_VALUE, argument);
 			}
+			convert_result(this,
+			               argument,
+			               argument_destination(argument, state->record),
+			               arg,
+			               is_next_argv_used ? n + 1 : n);
+			state->next = is_next_argv_used ? n + 2 : n + 1;
 			break;
 		}
 	case ARGPARSER_ACTION_NARGS_OPTIONAL:
@@ -436,10 +1032,7 @@ static int parse_action_store(argparser_t this,
 }
 
 static int parse_action_store_const(argparser_t this,
-                                    size_t argc,
-                                    char *const *argv,
-                                    struct argparser_argument **argv_argument_links,
-                                    size_t n,
+                                    struct parse_state *state,
                                     struct argparser_argument *argument) {
 	bool is_positional = argument->name;
 	switch (argument->action_nargs) {
@@ -449,10 +1042,10 @@ static int parse_action_store_const(argparser_t this,
 		}
 		else {
 			if (argument->type == ARGPARSER_TYPE_BOOL) {
-				*((bool *)(argument->destination)) =
+				*((bool *)argument_destination(argument, state->record)) =
 					(bool)(argument->const_value);
 			}
-			argv_argument_links[n] = argument;
+			state->next = state->n + 1;
 		}
 		break;
 	case ARGPARSER_ACTION_NARGS_OPTIONAL:
@@ -473,52 +1066,76 @@ static int parse_action_store_const(argparser_t this,
 	return 0;
 }
 
+static int parse_action_count(argparser_t this, struct parse_state *state, struct argparser_argument *argument) {
+	(*(int *)argument_destination(argument, state->record))++;
+	state->next = state->n + 1;
+	return 0;
+}
+
 static void convert_result(argparser_t argparser,
                            struct argparser_argument *argument,
-                           const char *arg) {
-	static const char *
-		type_names[] = { [ARGPARSER_TYPE_UINT] = "unsigned int", [ARGPARSER_TYPE_USHORT] = "unsigned short", [ARGPARSER_TYPE_LONG] = "long" };
-	enum cmn_strto_error ret;
+                           void *destination,
+                           const char *arg,
+                           size_t n) {
+	static const char *type_names[] = {
+		[ARGPARSER_TYPE_BOOL] = "bool",
+		[ARGPARSER_TYPE_CSTR] = "string",
+		[ARGPARSER_TYPE_INT] = "int",
+		[ARGPARSER_TYPE_UINT] = "unsigned int",
+		[ARGPARSER_TYPE_USHORT] = "unsigned short",
+		[ARGPARSER_TYPE_LONG] = "long",
+		[ARGPARSER_TYPE_STRING_VIEW] = "string",
+	};
 	const char *type_name;
 	const char *arg_name;
-	switch (argument->type) {
-	case ARGPARSER_TYPE_INT:
-		ret = cmn_strto_n((int *)argument->destination, arg);
-		break;
-	case ARGPARSER_TYPE_LONG:
-		ret = cmn_strto_n((long *)argument->destination, arg);
-		break;
-	case ARGPARSER_TYPE_USHORT:
-		ret = cmn_strto_n((unsigned short *)argument->destination, arg);
-		break;
-	case ARGPARSER_TYPE_UINT:
-		ret = cmn_strto_n((unsigned int *)argument->destination, arg);
-		break;
-	default:
-		return; // unreachable
+	enum argparser_phase previous_phase;
+	bool is_choice;
+	bool is_converted;
+	previous_phase = stats_enter_phase(argparser, ARGPARSER_PHASE_CONVERT);
+	is_choice = is_valid_choice(argument, arg);
+	is_converted = is_choice && convert_value(argument->type, arg, destination);
+	stats_enter_phase(argparser, previous_phase);
+	trace(argparser,
+	      n,
+	      arg,
+	      is_converted ? ARGPARSER_TRACE_CONVERT : ARGPARSER_TRACE_CONVERT_FAILED,
+	      argument);
+	if (is_converted) {
+		return;
 	}
-	type_name = type_names[argument->type];
-	if (ret != CMN_STRTO_SUCCESS) {
-		argparser_print_usage(argparser);
-		if (argument->name) {
-			arg_name = argument->name;
+	argparser_print_usage(argparser);
+	if (argument->name) {
+		arg_name = argument->name;
+	}
+	else {
+		asprintf((char **)&arg_name,
+		         "%s%s%s%s%s",
+		         argument->flag ? argparser->short_prefix : "",
+		         argument->flag ? argument->flag : "",
+		         argument->flag && argument->long_flag ? "/" : "",
+		         argument->long_flag ? argparser->long_prefix : "",
+		         argument->long_flag ? argument->long_flag : "");
+	}
+	if (!is_choice) {
+		const char *suggestion = suggest_choice(argument, arg);
+		printf("%s: error: argument %s: invalid choice: '%s'", argparser->program_name, arg_name, arg);
+		if (suggestion) {
+			printf(", maybe you meant '%s'?", suggestion);
 		}
-		else {
-			asprintf((char **)&arg_name,
-			         "%s%s%s%s%s",
-			         argument->flag ? "-" : "",
-			         argument->flag ? argument->flag : "",
-			         argument->flag && argument->long_flag ? "/" : "",
-			         argument->long_flag ? "--" : "",
-			         argument->long_flag ? argument->long_flag : "");
-		}
-		fprintf(stdout,
-		        "%s: error: argument %s: invalid %s value: '%s'",
-		        argparser->program_name,
-		        arg_name,
-		        type_name,
-		        arg);
-		fflush(stdout);
+		printf(" (choose from ");
+		for (char **choice = argument->choices; *choice; choice++) {
+			printf("'%s'%s", *choice, choice[1] ? "," : "");
+		}
+		printf(")\n");
 		exit(EXIT_FAILURE);
 	}
+	type_name = type_names[argument->type];
+	fprintf(stdout,
+	        "%s: error: argument %s: invalid %s value: '%s'",
+	        argparser->program_name,
+	        arg_name,
+	        type_name,
+	        arg);
+	fflush(stdout);
+	exit(EXIT_FAILURE);
 }
@@ -0,0 +1,159 @@
+#include "pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "stats.h"
+
+/* Size of the first chunk, each following one doubles up to the maximum. */
+#define POOL_CHUNK_SIZE 4096
+#define POOL_CHUNK_MAX_SIZE (1024 * 1024)
+
+static bool make_room(argparser_t argparser, size_t size);
+static const char *find_string(const struct string_pool *pool, const char *string);
+static bool insert_string(argparser_t argparser, const char *string);
+static uint32_t hash_string(const char *string);
+
+extern void *pool_alloc(argparser_t argparser, size_t size) {
+	struct string_pool *pool = argparser->pool;
+	size_t padding;
+	void *memory;
+	padding = pool->chunks ? (alignof(max_align_t) - pool->chunks->used % alignof(max_align_t)) % alignof(max_align_t) : 0;
+	try(make_room(argparser, padding + size), false, fail);
+	padding = (alignof(max_align_t) - pool->chunks->used % alignof(max_align_t)) % alignof(max_align_t);
+	memory = pool->chunks->data + pool->chunks->used + padding;
+	pool->chunks->used += padding + size;
+	return memory;
+fail:
+	return nullptr;
+}
+
+extern void pool_begin(argparser_t argparser) {
+	argparser->pool->pending = 0;
+	argparser->pool->is_failed = false;
+}
+
+extern void pool_append(argparser_t argparser, const char *string, size_t length) {
+	struct string_pool *pool = argparser->pool;
+	// One more byte is always kept for the terminator.
+	if (pool->is_failed || !make_room(argparser, length + 1)) {
+		pool->is_failed = true;
+		return;
+	}
+	memcpy(pool->chunks->data + pool->chunks->used + pool->pending, string, length);
+	pool->pending += length;
+}
+
+extern const char *pool_end(argparser_t argparser) {
+	struct string_pool *pool = argparser->pool;
+	const char *interned;
+	char *string;
+	if (pool->is_failed || !make_room(argparser, 1)) {
+		pool->pending = 0;
+		return nullptr;
+	}
+	string = (char *)pool->chunks->data + pool->chunks->used;
+	string[pool->pending] = '\0';
+	interned = find_string(pool, string);
+	if (interned == nullptr) {
+		interned = string;
+		pool->chunks->used += pool->pending + 1;
+		// A string that cannot be indexed is still valid, only never shared.
+		insert_string(argparser, string);
+	}
+	pool->pending = 0;
+	return interned;
+}
+
+extern void pool_destroy(struct string_pool *pool) {
+	while (pool->chunks) {
+		struct pool_chunk *next = pool->chunks->next;
+		free(pool->chunks);
+		pool->chunks = next;
+	}
+	free(pool->strings);
+	*pool = (struct string_pool){ 0 };
+}
+
+/*
+ * Make room for size bytes after the used ones and the string being built,
+ * which is moved to the new chunk if the current one is full.
+ */
+static bool make_room(argparser_t argparser, size_t size) {
+	struct string_pool *pool = argparser->pool;
+	struct pool_chunk *chunk = pool->chunks;
+	size_t chunk_size;
+	if (chunk && chunk->size - chunk->used - pool->pending >= size) {
+		return true;
+	}
+	chunk_size = chunk ? chunk->size * 2 : POOL_CHUNK_SIZE;
+	chunk_size = (chunk_size > POOL_CHUNK_MAX_SIZE) ? POOL_CHUNK_MAX_SIZE : chunk_size;
+	chunk_size = (pool->pending + size > chunk_size) ? pool->pending + size : chunk_size;
+	try(chunk = malloc(sizeof *chunk + chunk_size), nullptr, fail);
+	stats_count_allocation(argparser, sizeof *chunk + chunk_size);
+	*chunk = (struct pool_chunk){ .next = pool->chunks, .size = chunk_size };
+	if (pool->pending) {
+		memcpy(chunk->data, pool->chunks->data + pool->chunks->used, pool->pending);
+	}
+	pool->chunks = chunk;
+	return true;
+fail:
+	return false;
+}
+
+static const char *find_string(const struct string_pool *pool, const char *string) {
+	size_t mask = pool->strings_capacity - 1;
+	if (pool->strings_capacity == 0) {
+		return nullptr;
+	}
+	for (size_t i = hash_string(string) & mask; pool->strings[i]; i = (i + 1) & mask) {
+		if (strcmp(pool->strings[i], string) == 0) {
+			return pool->strings[i];
+		}
+	}
+	return nullptr;
+}
+
+static bool insert_string(argparser_t argparser, const char *string) {
+	struct string_pool *pool = argparser->pool;
+	size_t i;
+	if ((pool->strings_number + 1) * 2 > pool->strings_capacity) {
+		size_t capacity = pool->strings_capacity ? pool->strings_capacity * 2 : 16;
+		const char **strings;
+		try(strings = calloc(capacity, sizeof *strings), nullptr, fail);
+		stats_count_allocation(argparser, capacity * sizeof *strings);
+		for (size_t j = 0; j < pool->strings_capacity; j++) {
+			if (pool->strings[j]) {
+				i = hash_string(pool->strings[j]) & (capacity - 1);
+				while (strings[i]) {
+					i = (i + 1) & (capacity - 1);
+				}
+				strings[i] = pool->strings[j];
+			}
+		}
+		free(pool->strings);
+		pool->strings = strings;
+		pool->strings_capacity = capacity;
+	}
+	i = hash_string(string) & (pool->strings_capacity - 1);
+	while (pool->strings[i]) {
+		i = (i + 1) & (pool->strings_capacity - 1);
+	}
+	pool->strings[i] = string;
+	pool->strings_number++;
+	return true;
+fail:
+	return false;
+}
+
+/* FNV-1a. */
+static inline uint32_t hash_string(const char *string) {
+	uint32_t hash = 2166136261u;
+	for (; *string; string++) {
+		hash ^= (unsigned char)*string;
+		hash *= 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "struct_argparser.h"
+
+/*
+ * The pool of a parser tree hands out memory in chunks that are only freed
+ * with the root parser, so that building many subparsers costs a few large
+ * allocations instead of many small ones. Strings are built in place and
+ * interned: building a string equal to one already in the pool gives back the
+ * existing copy.
+ */
+
+/**
+ * @brief Allocate size bytes, aligned for any type, from the pool of argparser.
+ *
+ * @return the memory or nullptr on failure.
+ */
+extern void *pool_alloc(argparser_t argparser, size_t size);
+
+/**
+ * @brief Start building a string in the pool of argparser.
+ *
+ * @details Until pool_end() no other memory may be taken from the pool.
+ */
+extern void pool_begin(argparser_t argparser);
+
+extern void pool_append(argparser_t argparser, const char *string, size_t length);
+
+/**
+ * @brief Finish the string being built.
+ *
+ * @return the interned string or nullptr if an append failed.
+ */
+extern const char *pool_end(argparser_t argparser);
+
+extern void pool_destroy(struct string_pool *pool);
@@ -0,0 +1,371 @@
+#include "config.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <buracchi/common/utilities/try.h>
+#include <buracchi/common/utilities/utilities.h>
+
+#include "index.h"
+#include "stats.h"
+
+static int reload_state_init(argparser_t argparser);
+static void reload_state_free(struct config_reload *reload);
+static void release_source(argparser_t argparser, struct argparser_snapshot *snapshot);
+static void begin_rewrite(struct argparser_snapshot *snapshot);
+static void end_rewrite(struct argparser_snapshot *snapshot);
+static int compare_destinations(const void *a, const void *b);
+
+extern int argparser_enable_config_reload(argparser_t argparser) {
+	struct config_source *config;
+	if (argparser->is_record) {
+		return 1;
+	}
+	argparser->is_config_reload_enabled = true;
+	if (argparser->config == nullptr || argparser->config->is_private_copy) {
+		return 0;
+	}
+	try(config = config_source_open(argparser, argparser->config->path, true), nullptr, fail);
+	config_source_destroy(argparser->config);
+	argparser->config = config;
+	return 0;
+fail:
+	return 1;
+}
+
+extern int config_reload_prepare(argparser_t argparser, const uint64_t *seen) {
+	struct config_reload *reload = argparser->reload;
+	if (reload == nullptr || reload->arguments_number != argparser->arguments_number) {
+		try(reload_state_init(argparser), 1, fail);
+		reload = argparser->reload;
+	}
+	for (size_t i = 0; i < reload->arguments_number; i++) {
+		reload->from_command_line[i] = bitset_test(seen, i);
+	}
+	for (size_t i = 0; i < reload->arguments_number; i++) {
+		const struct argparser_argument *argument = &argparser->arguments[i];
+		if (argument->destination == nullptr) {
+			continue;
+		}
+		// Optional strings start from their default pointer, as in the defaults image.
+		if (argument->action == ARGPARSER_ACTION_STORE &&
+		    argument->type == ARGPARSER_TYPE_CSTR && !argument->name &&
+		    !argument->is_required) {
+			reload->defaults[i].cstr = (char *)argument->default_value;
+			continue;
+		}
+		memcpy(&reload->defaults[i], argument->destination, value_size(argument->type));
+	}
+	return 0;
+fail:
+	return 1;
+}
+
+extern void config_reload_publish(argparser_t argparser) {
+	struct config_reload *reload = argparser->reload;
+	struct argparser_snapshot *current;
+	struct argparser_snapshot *next;
+	current = atomic_load_explicit(&reload->current, memory_order_acquire);
+	next = (current == &reload->snapshots[0]) ? &reload->snapshots[1] : &reload->snapshots[0];
+	begin_rewrite(next);
+	for (size_t i = 0; i < reload->arguments_number; i++) {
+		const struct argparser_argument *argument = &argparser->arguments[i];
+		if (argument->destination) {
+			memcpy(&next->values[i], argument->destination, value_size(argument->type));
+		}
+	}
+	memset(next->changes, 0, BITSET_WORDS(reload->arguments_number) * sizeof *next->changes);
+	next->changes_number = 0;
+	release_source(argparser, next);
+	next->source = argparser->config;
+	end_rewrite(next);
+	atomic_store_explicit(&reload->current, next, memory_order_release);
+}
+
+extern bool config_reload_references(argparser_t argparser, const struct config_source *source) {
+	const struct config_reload *reload = argparser->reload;
+	return reload && (reload->snapshots[0].source == source || reload->snapshots[1].source == source);
+}
+
+extern void config_reload_destroy(argparser_t argparser) {
+	struct config_reload *reload = argparser->reload;
+	if (argparser->config && !config_reload_references(argparser, argparser->config)) {
+		config_source_destroy(argparser->config);
+	}
+	if (reload->snapshots[0].source) {
+		config_source_destroy(reload->snapshots[0].source);
+	}
+	if (reload->snapshots[1].source && reload->snapshots[1].source != reload->snapshots[0].source) {
+		config_source_destroy(reload->snapshots[1].source);
+	}
+	if (reload->watch_fd != -1) {
+		close(reload->watch_fd);
+	}
+	reload_state_free(reload);
+	argparser->reload = nullptr;
+	argparser->config = nullptr;
+}
+
+extern int argparser_config_watch(argparser_t argparser) {
+#ifdef __linux__
+	struct config_reload *reload = argparser->reload;
+	const char *path;
+	const char *slash;
+	char *directory;
+	int fd;
+	if (reload == nullptr) {
+		return -1;
+	}
+	if (reload->watch_fd != -1) {
+		return reload->watch_fd;
+	}
+	path = argparser->config->path;
+	slash = strrchr(path, '/');
+	// Editors usually replace the file, so the directory entry is watched.
+	try(directory = slash ? strndup(path, slash == path ? 1 : slash - path) : strdup("."),
+	    nullptr,
+	    fail);
+	stats_count_allocation(argparser, strlen(directory) + 1);
+	try(fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC), -1, fail2);
+	try(inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO), -1, fail3);
+	free(directory);
+	reload->watch_fd = fd;
+	reload->watch_name = slash ? slash + 1 : path;
+	return fd;
+fail3:
+	close(fd);
+fail2:
+	free(directory);
+fail:
+	return -1;
+#else
+	return -1;
+#endif
+}
+
+extern int argparser_config_poll(argparser_t argparser) {
+#ifdef __linux__
+	struct config_reload *reload = argparser->reload;
+	_Alignas(struct inotify_event) char buffer[4096];
+	bool is_config_changed = false;
+	ssize_t length;
+	if (reload == nullptr || reload->watch_fd == -1) {
+		return 0;
+	}
+	while ((length = read(reload->watch_fd, buffer, sizeof buffer)) > 0) {
+		const struct inotify_event *event;
+		for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof *event + event->len) {
+			event = (const struct inotify_event *)ptr;
+			if (event->len && streq(event->name, reload->watch_name)) {
+				is_config_changed = true;
+			}
+		}
+	}
+	return is_config_changed ? argparser_config_reload(argparser) : 0;
+#else
+	return 0;
+#endif
+}
+
+extern int argparser_config_reload(argparser_t argparser) {
+	struct config_reload *reload = argparser->reload;
+	struct argparser_snapshot *current;
+	struct argparser_snapshot *next;
+	struct config_source *source;
+	if (reload == nullptr) {
+		return 1;
+	}
+	current = atomic_load_explicit(&reload->current, memory_order_acquire);
+	next = (current == &reload->snapshots[0]) ? &reload->snapshots[1] : &reload->snapshots[0];
+	try(source = config_source_open(argparser, argparser->config->path, true), nullptr, fail);
+	begin_rewrite(next);
+	for (size_t i = 0; i < reload->arguments_number; i++) {
+		next->values[i] = reload->from_command_line[i] ? current->values[i] : reload->defaults[i];
+	}
+	for (size_t i = 0; i < source->entries_number; i++) {
+		const struct config_entry *entry = &source->entries[i];
+		struct argparser_argument *argument;
+		size_t position;
+		argument = argument_index_find(argparser, entry->key, entry->key_len, true);
+		if (argument == nullptr || !config_argument_is_settable(argument)) {
+			goto fail2;
+		}
+		position = argument - argparser->arguments;
+		if (position >= reload->arguments_number) {
+			goto fail2;
+		}
+		if (reload->from_command_line[position]) {
+			continue;
+		}
+		try(config_entry_value(argument, entry, &next->values[position]), false, fail2);
+	}
+	memset(next->changes, 0, BITSET_WORDS(reload->arguments_number) * sizeof *next->changes);
+	next->changes_number = 0;
+	for (size_t i = 0; i < reload->arguments_number; i++) {
+		enum argparser_type type = argparser->arguments[i].type;
+		if (!value_equals(type, &next->values[i], &current->values[i])) {
+			bitset_set(next->changes, i);
+			next->changes_number++;
+		}
+	}
+	release_source(argparser, next);
+	next->source = source;
+	argparser->config = source;
+	end_rewrite(next);
+	atomic_store_explicit(&reload->current, next, memory_order_release);
+	return 0;
+fail2:
+	end_rewrite(next);
+	config_source_destroy(source);
+fail:
+	return 1;
+}
+
+extern const struct argparser_snapshot *argparser_config_snapshot(argparser_t argparser) {
+	if (argparser->reload == nullptr) {
+		return nullptr;
+	}
+	return atomic_load_explicit(&argparser->reload->current, memory_order_acquire);
+}
+
+extern const void *argparser_snapshot_get(const struct argparser_snapshot *snapshot,
+                                          const void *destination) {
+	const struct config_reload *reload = snapshot->argparser->reload;
+	const struct destination_entry key = { .destination = destination };
+	const struct destination_entry *entry;
+	entry = bsearch(&key,
+	                reload->destinations,
+	                reload->arguments_number,
+	                sizeof *reload->destinations,
+	                compare_destinations);
+	return entry ? &snapshot->values[entry->position] : nullptr;
+}
+
+extern size_t argparser_snapshot_generation(const struct argparser_snapshot *snapshot) {
+	return atomic_load_explicit(&snapshot->generation, memory_order_acquire);
+}
+
+extern bool argparser_snapshot_validate(const struct argparser_snapshot *snapshot, size_t generation) {
+	// Orders the reads of the values before the second read of the generation.
+	atomic_thread_fence(memory_order_acquire);
+	return generation % 2 == 0 && atomic_load_explicit(&snapshot->generation, memory_order_relaxed) == generation;
+}
+
+extern size_t argparser_snapshot_changes_number(const struct argparser_snapshot *snapshot) {
+	return snapshot->changes_number;
+}
+
+extern const struct argparser_argument *
+argparser_snapshot_next_change(const struct argparser_snapshot *snapshot, size_t *position) {
+	const size_t arguments_number = snapshot->argparser->reload->arguments_number;
+	size_t i = *position;
+	while (i < arguments_number) {
+		uint64_t word = snapshot->changes[i / 64] >> (i % 64);
+		if (word) {
+			i += __builtin_ctzll(word);
+			*position = i + 1;
+			return &snapshot->argparser->arguments[i];
+		}
+		i = (i / 64 + 1) * 64;
+	}
+	*position = arguments_number;
+	return nullptr;
+}
+
+static int reload_state_init(argparser_t argparser) {
+	struct config_reload *reload;
+	const size_t n = argparser->arguments_number;
+	try(reload = calloc(1, sizeof *reload), nullptr, fail);
+	stats_count_allocation(argparser, sizeof *reload);
+	reload->arguments_number = n;
+	reload->watch_fd = -1;
+	for (size_t i = 0; i < 2; i++) {
+		reload->snapshots[i].argparser = argparser;
+		try(reload->snapshots[i].values = calloc(n, sizeof *reload->snapshots[i].values),
+		    nullptr,
+		    fail2);
+		try(reload->snapshots[i].changes = calloc(BITSET_WORDS(n), sizeof(uint64_t)),
+		    nullptr,
+		    fail2);
+		stats_count_allocation(argparser, n * sizeof *reload->snapshots[i].values);
+		stats_count_allocation(argparser, BITSET_WORDS(n) * sizeof(uint64_t));
+	}
+	try(reload->defaults = calloc(n, sizeof *reload->defaults), nullptr, fail2);
+	try(reload->from_command_line = calloc(n, sizeof *reload->from_command_line), nullptr, fail2);
+	try(reload->destinations = malloc(n * sizeof *reload->destinations), nullptr, fail2);
+	stats_count_allocation(argparser, n * sizeof *reload->defaults);
+	stats_count_allocation(argparser, n * sizeof *reload->from_command_line);
+	stats_count_allocation(argparser, n * sizeof *reload->destinations);
+	for (size_t i = 0; i < n; i++) {
+		reload->destinations[i] = (struct destination_entry){
+			.destination = argparser->arguments[i].destination,
+			.position = i,
+		};
+	}
+	qsort(reload->destinations, n, sizeof *reload->destinations, compare_destinations);
+	atomic_init(&reload->current, &reload->snapshots[0]);
+	if (argparser->reload) {
+		// Arguments were added since the last parse, keep sources and watcher.
+		reload->snapshots[0].source = argparser->reload->snapshots[0].source;
+		reload->snapshots[1].source = argparser->reload->snapshots[1].source;
+		reload->watch_fd = argparser->reload->watch_fd;
+		reload->watch_name = argparser->reload->watch_name;
+		reload_state_free(argparser->reload);
+	}
+	argparser->reload = reload;
+	return 0;
+fail2:
+	reload_state_free(reload);
+fail:
+	return 1;
+}
+
+static void reload_state_free(struct config_reload *reload) {
+	for (size_t i = 0; i < 2; i++) {
+		free(reload->snapshots[i].values);
+		free(reload->snapshots[i].changes);
+	}
+	free(reload->defaults);
+	free(reload->from_command_line);
+	free(reload->destinations);
+	free(reload);
+}
+
+/* Free the source of a snapshot about to be overwritten, unless still in use. */
+static void release_source(argparser_t argparser, struct argparser_snapshot *snapshot) {
+	const struct config_reload *reload = argparser->reload;
+	const struct argparser_snapshot *other;
+	other = (snapshot == &reload->snapshots[0]) ? &reload->snapshots[1] : &reload->snapshots[0];
+	if (snapshot->source && snapshot->source != other->source && snapshot->source != argparser->config) {
+		config_source_destroy(snapshot->source);
+	}
+	snapshot->source = nullptr;
+}
+
+/*
+ * As in a sequence lock, the generation of a snapshot is odd while it is
+ * rewritten, so that readers holding it can tell that what they read may be
+ * torn and start again from the current snapshot.
+ */
+static void begin_rewrite(struct argparser_snapshot *snapshot) {
+	size_t generation = atomic_load_explicit(&snapshot->generation, memory_order_relaxed);
+	atomic_store_explicit(&snapshot->generation, generation + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+static void end_rewrite(struct argparser_snapshot *snapshot) {
+	size_t generation = atomic_load_explicit(&snapshot->generation, memory_order_relaxed);
+	atomic_store_explicit(&snapshot->generation, generation + 1, memory_order_release);
+}
+
+static int compare_destinations(const void *a, const void *b) {
+	uintptr_t destination_a = (uintptr_t)((const struct destination_entry *)a)->destination;
+	uintptr_t destination_b = (uintptr_t)((const struct destination_entry *)b)->destination;
+	return (destination_a > destination_b) - (destination_a < destination_b);
+}
@@ -0,0 +1,63 @@
+#include "stats.h"
+
+#include <string.h>
+#include <time.h>
+
+static void set_stats(argparser_t argparser, struct stats_state *stats);
+static inline uint64_t now_ns(void);
+
+extern void argparser_enable_stats(argparser_t argparser) {
+	if (argparser->stats) {
+		return;
+	}
+	argparser->stats_storage = (struct stats_state){ .phase = STATS_PHASE_IDLE };
+	set_stats(argparser, &argparser->stats_storage);
+}
+
+extern struct argparser_stats argparser_get_stats(argparser_t argparser) {
+	if (argparser->stats == nullptr) {
+		return (struct argparser_stats){ 0 };
+	}
+	return argparser->stats->counters;
+}
+
+extern void argparser_reset_stats(argparser_t argparser) {
+	if (argparser->stats) {
+		memset(&argparser->stats->counters, 0, sizeof argparser->stats->counters);
+	}
+}
+
+extern const char *argparser_phase_name(enum argparser_phase phase) {
+	static const char *names[] = {
+		[ARGPARSER_PHASE_MATCH] = "match",
+		[ARGPARSER_PHASE_CONVERT] = "convert",
+		[ARGPARSER_PHASE_REQUIRED] = "required",
+		[ARGPARSER_PHASE_DEFAULTS] = "defaults",
+		[ARGPARSER_PHASE_FORMAT] = "format",
+	};
+	return (phase < ARGPARSER_PHASES_NUMBER) ? names[phase] : nullptr;
+}
+
+extern enum argparser_phase stats_switch_phase(struct stats_state *stats, enum argparser_phase phase) {
+	enum argparser_phase previous = stats->phase;
+	uint64_t now = now_ns();
+	if (previous != STATS_PHASE_IDLE) {
+		stats->counters.phase_ns[previous] += now - stats->phase_start_ns;
+	}
+	stats->phase = phase;
+	stats->phase_start_ns = now;
+	return previous;
+}
+
+static void set_stats(argparser_t argparser, struct stats_state *stats) {
+	argparser->stats = stats;
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		set_stats(argparser->subparsers[i].parser, stats);
+	}
+}
+
+static inline uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "struct_argparser.h"
+
+/* Add n to a counter if statistics are enabled. */
+#define stats_add(argparser, counter, n)                                       \
+	do {                                                                   \
+		if ((argparser)->stats) {                                      \
+			(argparser)->stats->counters.counter += (n);           \
+		}                                                              \
+	} while (0)
+
+extern enum argparser_phase stats_switch_phase(struct stats_state *stats, enum argparser_phase phase);
+
+/**
+ * @brief Account the time elapsed since the last switch to the current phase
+ * and make phase the current one.
+ *
+ * @details Nested phases restore the previous one when they end, so that time
+ * is never accounted twice:
+ *
+ *     enum argparser_phase previous = stats_enter_phase(argparser, ARGPARSER_PHASE_CONVERT);
+ *     ...
+ *     stats_enter_phase(argparser, previous);
+ *
+ * @return the previous phase, STATS_PHASE_IDLE outside of the library.
+ */
+static inline enum argparser_phase stats_enter_phase(argparser_t argparser, enum argparser_phase phase) {
+	return argparser->stats ? stats_switch_phase(argparser->stats, phase) : phase;
+}
+
+static inline void stats_count_allocation(argparser_t argparser, size_t bytes) {
+	if (argparser->stats) {
+		argparser->stats->counters.allocations++;
+		argparser->stats->counters.allocated_bytes += bytes;
+	}
+}
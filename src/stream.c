@@ -0,0 +1,402 @@
+#include <buracchi/argparser/argparser.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "defaults.h"
+#include "index.h"
+#include "stats.h"
+#include "struct_argparser.h"
+#include "utils.h"
+#include "values.h"
+
+/* A parser the stream has entered, the first one is the main parser. */
+struct stream_level {
+	argparser_t argparser;
+	uint64_t *seen;         /* bitset of the arguments given */
+	size_t next_positional; /* position of the next positional to match */
+};
+
+struct argparser_stream {
+	struct stream_level *levels;
+	size_t levels_number;
+	size_t levels_capacity;
+	size_t token_index;
+	bool is_terminated; /* an options terminator (--) has been fed */
+	bool is_finished;
+	struct argparser_argument *pending; /* option waiting for its value */
+	struct argparser_event *events;     /* queued events, the oldest at head */
+	size_t events_head;
+	size_t events_number;
+	size_t events_capacity;
+};
+
+static int enter_level(argparser_stream_t stream, argparser_t argparser);
+static int push_event(argparser_stream_t stream,
+                      argparser_t argparser,
+                      enum argparser_event_type type,
+                      enum argparser_stream_error error,
+                      const char *token,
+                      const struct argparser_argument *argument);
+static int feed_option(argparser_stream_t stream, const char *token);
+static int feed_operand(argparser_stream_t stream, const char *token);
+static int apply_option(argparser_stream_t stream,
+                        const char *token,
+                        struct argparser_argument *argument,
+                        const char *attached_value);
+static int bind_value(argparser_stream_t stream,
+                      argparser_t argparser,
+                      const char *token,
+                      struct argparser_argument *argument);
+static struct argparser_argument *next_positional(struct stream_level *level);
+static int finish_level(argparser_stream_t stream, struct stream_level *level, bool is_last);
+static bool is_streamable(argparser_t argparser);
+
+extern argparser_stream_t argparser_stream_init(argparser_t argparser) {
+	argparser_stream_t stream;
+	if (argparser->is_record || !is_streamable(argparser)) {
+		return nullptr;
+	}
+	try(stream = calloc(1, sizeof *stream), nullptr, fail);
+	stats_count_allocation(argparser, sizeof *stream);
+	try(enter_level(stream, argparser), 1, fail2);
+	return stream;
+fail2:
+	free(stream);
+fail:
+	return nullptr;
+}
+
+extern void argparser_stream_destroy(argparser_stream_t stream) {
+	for (size_t i = 0; i < stream->levels_number; i++) {
+		free(stream->levels[i].seen);
+	}
+	free(stream->levels);
+	free(stream->events);
+	free(stream);
+}
+
+extern int argparser_stream_feed(argparser_stream_t stream, const char *token) {
+	argparser_t argparser = stream->levels[stream->levels_number - 1].argparser;
+	bool is_option = !stream->is_terminated && is_prefix_char(argparser, token[0]);
+	int result;
+	if (stream->is_finished) {
+		return 1;
+	}
+	stats_add(argparser, tokens, 1);
+	if (stream->pending) {
+		struct argparser_argument *argument = stream->pending;
+		stream->pending = nullptr;
+		if (!is_option || isnumber(token)) {
+			result = bind_value(stream, argparser, token, argument);
+			stream->token_index++;
+			return result;
+		}
+		try(push_event(stream,
+		               argparser,
+		               ARGPARSER_EVENT_ERROR,
+		               ARGPARSER_STREAM_ERROR_MISSING_VALUE,
+		               token,
+		               argument),
+		    1,
+		    fail);
+	}
+	if (is_option && strcmp(token, argparser->long_prefix) == 0) {
+		stream->is_terminated = true;
+		result = 0;
+	}
+	else {
+		result = is_option ? feed_option(stream, token) : feed_operand(stream, token);
+	}
+	stream->token_index++;
+	return result;
+fail:
+	return 1;
+}
+
+extern int argparser_stream_finish(argparser_stream_t stream) {
+	if (stream->is_finished) {
+		return 1;
+	}
+	stream->is_finished = true;
+	if (stream->pending) {
+		try(push_event(stream,
+		               stream->levels[stream->levels_number - 1].argparser,
+		               ARGPARSER_EVENT_ERROR,
+		               ARGPARSER_STREAM_ERROR_MISSING_VALUE,
+		               nullptr,
+		               stream->pending),
+		    1,
+		    fail);
+		stream->pending = nullptr;
+	}
+	for (size_t i = 0; i < stream->levels_number; i++) {
+		try(finish_level(stream, &stream->levels[i], i == stream->levels_number - 1), 1, fail);
+	}
+	try(push_event(stream,
+	               stream->levels[0].argparser,
+	               ARGPARSER_EVENT_END,
+	               ARGPARSER_STREAM_ERROR_NONE,
+	               nullptr,
+	               nullptr),
+	    1,
+	    fail);
+	return 0;
+fail:
+	return 1;
+}
+
+extern bool argparser_next_event(argparser_stream_t stream, struct argparser_event *event) {
+	if (stream->events_head == stream->events_number) {
+		return false;
+	}
+	*event = stream->events[stream->events_head++];
+	return true;
+}
+
+static int enter_level(argparser_stream_t stream, argparser_t argparser) {
+	struct stream_level *level;
+	size_t seen_words;
+	if (stream->levels_number == stream->levels_capacity) {
+		size_t capacity = stream->levels_capacity ? stream->levels_capacity * 2 : 2;
+		struct stream_level *levels;
+		try(levels = realloc(stream->levels, capacity * sizeof *levels), nullptr, fail);
+		stats_count_allocation(argparser, capacity * sizeof *levels);
+		stream->levels = levels;
+		stream->levels_capacity = capacity;
+	}
+	// As a parse, the parser starts from its defaults and the ones of its parents.
+	try(defaults_image_apply(argparser, nullptr), 1, fail);
+	for (size_t i = 0; i < argparser->parents_number; i++) {
+		try(defaults_image_apply(argparser->parents[i], nullptr), 1, fail);
+	}
+	level = &stream->levels[stream->levels_number];
+	level->argparser = argparser;
+	level->next_positional = 0;
+	seen_words = BITSET_WORDS(arguments_total(argparser));
+	try(level->seen = calloc(seen_words, sizeof *level->seen), nullptr, fail);
+	stats_count_allocation(argparser, seen_words * sizeof *level->seen);
+	stream->levels_number++;
+	return 0;
+fail:
+	return 1;
+}
+
+/* Events already pulled are discarded before the queue is grown. */
+static int push_event(argparser_stream_t stream,
+                      argparser_t argparser,
+                      enum argparser_event_type type,
+                      enum argparser_stream_error error,
+                      const char *token,
+                      const struct argparser_argument *argument) {
+	if (stream->events_head == stream->events_number) {
+		stream->events_head = 0;
+		stream->events_number = 0;
+	}
+	if (stream->events_number == stream->events_capacity) {
+		size_t capacity = stream->events_capacity ? stream->events_capacity * 2 : 8;
+		struct argparser_event *events;
+		try(events = realloc(stream->events, capacity * sizeof *events), nullptr, fail);
+		stats_count_allocation(argparser, capacity * sizeof *events);
+		stream->events = events;
+		stream->events_capacity = capacity;
+	}
+	stream->events[stream->events_number++] = (struct argparser_event){
+		.type = type,
+		.error = error,
+		.argparser = argparser,
+		.token_index = stream->token_index,
+		.token = token,
+		.argument = argument,
+	};
+	return 0;
+fail:
+	return 1;
+}
+
+/* Short flags may be clustered as in argparser_parse_args(). */
+static int feed_option(argparser_stream_t stream, const char *token) {
+	argparser_t argparser = stream->levels[stream->levels_number - 1].argparser;
+	struct argparser_argument *argument;
+	const char *cluster = token + 1;
+	if (token[1] && is_prefix_char(argparser, token[1]) && token[2]) {
+		size_t length = strlen(token + 2);
+		const char *equals = memchr(token + 2, '=', length);
+		if (equals) {
+			length = (size_t)(equals - (token + 2));
+		}
+		argument = argument_index_find_long(argparser, token + 2, length);
+		if (argument == nullptr || (equals && argument->action != ARGPARSER_ACTION_STORE)) {
+			return push_event(stream,
+			                  argparser,
+			                  ARGPARSER_EVENT_ERROR,
+			                  ARGPARSER_STREAM_ERROR_UNRECOGNIZED,
+			                  token,
+			                  nullptr);
+		}
+		return apply_option(stream, token, argument, equals ? equals + 1 : nullptr);
+	}
+	if (!argument_index_is_cluster(argparser, cluster)) {
+		return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_UNRECOGNIZED, token, nullptr);
+	}
+	do {
+		argument = argument_index_find_short(argparser, *cluster);
+		if (argument == nullptr) {
+			return push_event(stream,
+			                  argparser,
+			                  ARGPARSER_EVENT_ERROR,
+			                  ARGPARSER_STREAM_ERROR_UNRECOGNIZED,
+			                  token,
+			                  nullptr);
+		}
+		try(apply_option(stream, token, argument, cluster[1] ? cluster + 1 : nullptr), 1, fail);
+	} while (argument->action != ARGPARSER_ACTION_STORE && *++cluster);
+	return 0;
+fail:
+	return 1;
+}
+
+static int feed_operand(argparser_stream_t stream, const char *token) {
+	struct stream_level *level = &stream->levels[stream->levels_number - 1];
+	argparser_t argparser = level->argparser;
+	struct argparser_argument *argument = next_positional(level);
+	if (argument) {
+		bitset_set(level->seen, (size_t)(argument - argparser->arguments));
+		level->next_positional++;
+		return bind_value(stream, argparser, token, argument);
+	}
+	if (stream->is_terminated || argparser->subparsers_number == 0) {
+		return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_UNRECOGNIZED, token, nullptr);
+	}
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		stats_add(argparser, string_comparisons, 1);
+		if (strcmp(token, argparser->subparsers[i].command_name) == 0) {
+			stats_add(argparser, subcommand_hops, 1);
+			*(argparser->subparsers[i].selection_result) = token;
+			try(enter_level(stream, argparser->subparsers[i].parser), 1, fail);
+			return push_event(stream,
+			                  argparser->subparsers[i].parser,
+			                  ARGPARSER_EVENT_SUBCOMMAND,
+			                  ARGPARSER_STREAM_ERROR_NONE,
+			                  token,
+			                  nullptr);
+		}
+	}
+	return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_INVALID_SUBCOMMAND, token, nullptr);
+fail:
+	return 1;
+}
+
+static int apply_option(argparser_stream_t stream,
+                        const char *token,
+                        struct argparser_argument *argument,
+                        const char *attached_value) {
+	struct stream_level *level = &stream->levels[stream->levels_number - 1];
+	argparser_t argparser = level->argparser;
+	switch (argument->action) {
+	case ARGPARSER_ACTION_HELP:
+		break;
+	case ARGPARSER_ACTION_STORE:
+		if (argument->action_nargs != ARGPARSER_ACTION_NARGS_SINGLE) {
+			return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_UNRECOGNIZED, token, argument);
+		}
+		break;
+	case ARGPARSER_ACTION_STORE_CONST:
+		if (argument->type == ARGPARSER_TYPE_BOOL) {
+			*((bool *)(argument->destination)) = (bool)(argument->const_value);
+		}
+		break;
+	case ARGPARSER_ACTION_COUNT:
+		(*(int *)argument->destination)++;
+		break;
+	default:
+		return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_UNRECOGNIZED, token, argument);
+	}
+	bitset_set(level->seen, argument_position(argparser, argument));
+	try(push_event(stream, argparser, ARGPARSER_EVENT_OPTION, ARGPARSER_STREAM_ERROR_NONE, token, argument), 1, fail);
+	if (argument->action != ARGPARSER_ACTION_STORE) {
+		return 0;
+	}
+	if (attached_value) {
+		return bind_value(stream, argparser, attached_value, argument);
+	}
+	stream->pending = argument;
+	return 0;
+fail:
+	return 1;
+}
+
+static int bind_value(argparser_stream_t stream,
+                      argparser_t argparser,
+                      const char *token,
+                      struct argparser_argument *argument) {
+	if (!is_valid_choice(argument, token)) {
+		return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_INVALID_CHOICE, token, argument);
+	}
+	if (!convert_value(argument->type, token, argument->destination)) {
+		return push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_INVALID_VALUE, token, argument);
+	}
+	return push_event(stream, argparser, ARGPARSER_EVENT_VALUE, ARGPARSER_STREAM_ERROR_NONE, token, argument);
+}
+
+/* Positionals are matched in order, the cursor only moves forward. */
+static struct argparser_argument *next_positional(struct stream_level *level) {
+	argparser_t argparser = level->argparser;
+	while (level->next_positional < argparser->arguments_number &&
+	       !argparser->arguments[level->next_positional].name) {
+		level->next_positional++;
+	}
+	if (level->next_positional == argparser->arguments_number) {
+		return nullptr;
+	}
+	return &argparser->arguments[level->next_positional];
+}
+
+static int finish_level(argparser_stream_t stream, struct stream_level *level, bool is_last) {
+	argparser_t argparser = level->argparser;
+	struct argparser_argument *argument;
+	for (struct argument_cursor cursor = { 0 }; (argument = argument_next(argparser, &cursor));) {
+		if (bitset_test(level->seen, cursor.position)) {
+			continue;
+		}
+		if (argument->name || argument->is_required) {
+			try(push_event(stream,
+			               argparser,
+			               ARGPARSER_EVENT_ERROR,
+			               ARGPARSER_STREAM_ERROR_MISSING_REQUIRED,
+			               nullptr,
+			               argument),
+			    1,
+			    fail);
+		}
+	}
+	if (is_last && argparser->subparsers_options.required) {
+		try(push_event(stream, argparser, ARGPARSER_EVENT_ERROR, ARGPARSER_STREAM_ERROR_MISSING_REQUIRED, nullptr, nullptr),
+		    1,
+		    fail);
+	}
+	return 0;
+fail:
+	return 1;
+}
+
+/*
+ * Positionals are bound one token at a time, the ones taking an optional or
+ * variable number of values can only be split once every token is known.
+ */
+static bool is_streamable(argparser_t argparser) {
+	for (size_t i = 0; i < argparser->arguments_number; i++) {
+		if (argparser->arguments[i].name &&
+		    argparser->arguments[i].action_nargs != ARGPARSER_ACTION_NARGS_SINGLE) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		if (!is_streamable(argparser->subparsers[i].parser)) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include <buracchi/argparser/argparser.h>
 
+#include "values.h"
+
 struct subparser {
 	const char **selection_result;
 	const char *command_name;
@@ -9,6 +15,185 @@ struct subparser {
 	argparser_t parser;
 };
 
+/* Number of characters a short flag can be looked up by. */
+#define SHORT_FLAGS_NUMBER 128
+
+struct pool_chunk {
+	struct pool_chunk *next;
+	size_t size;
+	size_t used;
+	alignas(max_align_t) unsigned char data[];
+};
+
+/*
+ * Memory shared by a parser and all its subparsers, freed with the root: the
+ * subparsers themselves and the strings built for them, each string interned
+ * once.
+ */
+struct string_pool {
+	struct pool_chunk *chunks;  /* the current chunk first */
+	size_t pending;             /* bytes of the string being built */
+	bool is_failed;             /* an append of the string being built failed */
+	const char **strings;       /* open addressing set of the interned strings */
+	size_t strings_number;
+	size_t strings_capacity;    /* always a power of two or 0 */
+};
+
+/* Kinds of an indexed argument, known without reading its definition. */
+#define ARGUMENT_KIND_POSITIONAL 0x01
+#define ARGUMENT_KIND_LONG_FLAG  0x02
+
+/*
+ * The fields of an argument read while matching, 16 bytes instead of the
+ * whole struct argparser_argument, so that probes over parsers with thousands
+ * of options touch only this array until a candidate is found.
+ */
+struct argument_hot {
+	uint32_t key_hash;   /* hash of the destination name */
+	uint32_t key_length; /* truncated to 32 bits, only used to reject */
+	uint32_t position;   /* argument position + 1, 0 marks an empty slot */
+	uint8_t kind;        /* ARGUMENT_KIND_* flags */
+	char key_first;      /* first character of the destination name */
+};
+
+/* Longest string suggestions are made for, one bit per character. */
+#define SUGGEST_MAX_LENGTH 64
+
+/* Longest candidate within the edit distance allowed for any suggestion. */
+#define SUGGEST_MAX_CANDIDATE_LENGTH (SUGGEST_MAX_LENGTH + (SUGGEST_MAX_LENGTH + 1) / 4)
+
+struct length_item {
+	const char *key;
+	uint32_t position; /* of the argument or subparser named key */
+};
+
+/*
+ * Strings grouped by length in registration order, the ones of length l are
+ * items[offsets[l]] to items[offsets[l + 1] - 1], so that suggestions only
+ * visit the candidates whose length is close enough to the misspelled one.
+ * Strings longer than any candidate are left out.
+ */
+struct length_buckets {
+	size_t buckets_number;
+	uint32_t *offsets;         /* buckets_number + 1 entries */
+	struct length_item *items;
+};
+
+struct argument_index {
+	size_t arguments_number;     /* number of arguments indexed */
+	size_t subparsers_number;    /* number of subparsers indexed */
+	size_t capacity;             /* number of slots, always a power of two */
+	struct argument_hot *slots;
+	uint32_t *positionals;       /* positions of the positional arguments */
+	size_t positionals_number;
+	uint32_t short_flags[SHORT_FLAGS_NUMBER]; /* argument position + 1 by short flag character */
+	struct length_buckets long_flags;  /* of the options */
+	struct length_buckets subcommands; /* of the subparsers */
+};
+
+/*
+ * A variable, or in record mode a run of adjacent fields, and the position of
+ * its default value in the image.
+ */
+struct default_slot {
+	void *destination; /* the offset in the record in record mode */
+	size_t offset;
+	size_t size;
+};
+
+struct defaults_image {
+	bool is_built;
+	size_t arguments_number; /* number of arguments the image was built for */
+	unsigned char *values;
+	struct default_slot *slots;
+	size_t slots_number;
+};
+
+struct constraint_group {
+	enum argparser_constraint constraint;
+	const char **keys;       /* nullptr terminated, the first is the requiring one */
+	size_t first_word;       /* the words of the bitsets spanned by the group */
+	size_t words_number;
+	size_t mask;             /* offset of the mask of the group in the words */
+	size_t requiring;        /* position of the first argument */
+};
+
+struct constraints {
+	size_t groups_number;
+	struct constraint_group *groups;
+	size_t arguments_number; /* arguments the masks were compiled for, 0 if never */
+	uint64_t *words;         /* the masks of all the groups */
+};
+
+struct config_entry {
+	const char *key;   /* nullptr terminated view into the mapping */
+	size_t key_len;
+	const char *value; /* nullptr terminated view into the mapping */
+	size_t line;
+};
+
+struct config_source {
+	const char *path;
+	char *data;          /* private writable mapping of the file */
+	size_t mapping_size; /* size of the reserved region, 0 if unmapped */
+	bool is_private_copy; /* read in anonymous memory instead of mapped */
+	size_t entries_number;
+	struct config_entry *entries;
+};
+
+struct help_catalog {
+	const char *path;
+	struct config_source *source; /* entries sorted by key, nullptr until loaded */
+	bool is_loaded;               /* a failed load is not tried again */
+};
+
+struct argparser_snapshot {
+	argparser_t argparser;
+	struct config_source *source; /* the source the values were read from */
+	union argument_value *values;
+	uint64_t *changes; /* bitset of the arguments changed by the reload */
+	size_t changes_number;
+	_Atomic size_t generation; /* odd while the snapshot is being rewritten */
+};
+
+struct destination_entry {
+	const void *destination;
+	size_t position;
+};
+
+struct config_reload {
+	struct argparser_snapshot snapshots[2];
+	struct argparser_snapshot *_Atomic current;
+	size_t arguments_number; /* number of arguments when last parsed */
+	union argument_value *defaults;
+	bool *from_command_line;
+	struct destination_entry *destinations; /* sorted by address */
+	int watch_fd;
+	const char *watch_name;
+};
+
+#define BITSET_WORDS(n) (((n) + 63) / 64)
+
+static inline bool bitset_test(const uint64_t *bitset, size_t i) {
+	return (bitset[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void bitset_set(uint64_t *bitset, size_t i) {
+	bitset[i / 64] |= UINT64_C(1) << (i % 64);
+}
+
+/* Character class of the bytes that prefix optional arguments. */
+#define CHAR_CLASS_PREFIX 0x01
+
+/* Phase of a parser not running any library code. */
+#define STATS_PHASE_IDLE ARGPARSER_PHASES_NUMBER
+
+struct stats_state {
+	struct argparser_stats counters;
+	enum argparser_phase phase; /* phase the running time is accounted to */
+	uint64_t phase_start_ns;
+};
+
 struct argparser {
 	int argc;
 	const char *const *argv;
@@ -24,8 +209,144 @@ struct argparser {
 	bool exit_on_error; /* Determines whether ArgumentParser exits with error
 	                       info when an error occurs. (default: True) */
 	size_t arguments_number;
+	size_t arguments_capacity; /* number of arguments the storage has room for */
 	struct argparser_argument *arguments;
 	size_t subparsers_number;
 	struct subparser *subparsers;
 	struct argparser_subparsers_options subparsers_options;
+	struct argument_index index;
+	struct config_source *config;
+	bool is_config_reload_enabled;
+	struct config_reload *reload;
+	struct stats_state stats_storage;
+	struct stats_state *stats; /* nullptr unless enabled, shared with subparsers */
+	struct help_catalog catalog_storage;
+	struct help_catalog *catalog; /* nullptr unless set, shared with subparsers */
+	argparser_trace_callback trace_callback; /* shared with subparsers */
+	void *trace_data;
+	uint8_t char_class[256]; /* CHAR_CLASS_* flags of every byte */
+	char short_prefix[2];    /* prefix shown before flags in messages */
+	char long_prefix[3];     /* prefix shown before long flags in messages */
+	struct argparser_limits limits;
+	char **positional_lists; /* values of the list positionals of the last parse */
+	bool is_record;          /* destinations are offsets in a record */
+	bool is_bound;           /* destinations are variables */
+	struct defaults_image defaults;
+	struct constraints constraints;
+	struct argparser_constraint_error constraint_error; /* of the last parse started here */
+	struct string_pool pool_storage;
+	struct string_pool *pool; /* of the root parser, shared with subparsers */
+	bool is_pooled;           /* allocated from the pool of the root parser */
+	size_t subparsers_capacity;
+	argparser_t *parents;    /* referenced, their options follow the own ones */
+	size_t parents_number;
+	bool is_shared;          /* a parent of other parsers, no longer modifiable */
+	struct argparser_limit_error limit_error; /* of the last parse started here */
+};
+
+/*
+ * The -h/--help option every parser starts with, shared by all of them until
+ * their first argument is added.
+ */
+extern const struct argparser_argument builtin_help;
+
+/* The storage of an argument value, the offset it holds is rebased on record. */
+static inline void *argument_destination(const struct argparser_argument *argument, void *record) {
+	return record ? (char *)record + (uintptr_t)argument->destination : (void *)argument->destination;
+}
+
+/*
+ * The arguments of a parser are its own ones followed by the options of its
+ * parents, the help option of a parent excluded, so that positions index
+ * bitsets over all of them.
+ */
+static inline size_t arguments_total(argparser_t argparser) {
+	size_t total = argparser->arguments_number;
+	for (size_t i = 0; i < argparser->parents_number; i++) {
+		total += argparser->parents[i]->arguments_number - 1;
+	}
+	return total;
+}
+
+static inline struct argparser_argument *argument_at(argparser_t argparser, size_t position) {
+	if (position < argparser->arguments_number) {
+		return &argparser->arguments[position];
+	}
+	position -= argparser->arguments_number;
+	for (size_t i = 0;; i++) {
+		if (position < argparser->parents[i]->arguments_number - 1) {
+			return &argparser->parents[i]->arguments[position + 1];
+		}
+		position -= argparser->parents[i]->arguments_number - 1;
+	}
+}
+
+/*
+ * Walks the arguments in position order without the lookup from the start
+ * that argument_at() does for every position, a zeroed cursor starts from
+ * the first argument.
+ */
+struct argument_cursor {
+	size_t owner;    /* 0 for the parser itself, i + 1 for its parent i */
+	size_t index;    /* of the next argument in the arguments of the owner */
+	size_t next;     /* position of the next argument */
+	size_t position; /* of the argument last returned */
 };
+
+static inline struct argparser_argument *argument_next(argparser_t argparser, struct argument_cursor *cursor) {
+	for (; cursor->owner <= argparser->parents_number; cursor->owner++, cursor->index = 0) {
+		argparser_t owner = cursor->owner ? argparser->parents[cursor->owner - 1] : argparser;
+		if (cursor->owner && cursor->index == 0) {
+			cursor->index = 1;
+		}
+		if (cursor->index < owner->arguments_number) {
+			cursor->position = cursor->next++;
+			return &owner->arguments[cursor->index++];
+		}
+	}
+	return nullptr;
+}
+
+static inline size_t argument_position(argparser_t argparser, const struct argparser_argument *argument) {
+	size_t offset = argparser->arguments_number;
+	if (argument >= argparser->arguments && argument < argparser->arguments + argparser->arguments_number) {
+		return (size_t)(argument - argparser->arguments);
+	}
+	for (size_t i = 0; i < argparser->parents_number; i++) {
+		const struct argparser_argument *arguments = argparser->parents[i]->arguments;
+		if (argument > arguments && argument < arguments + argparser->parents[i]->arguments_number) {
+			return offset + (size_t)(argument - arguments) - 1;
+		}
+		offset += argparser->parents[i]->arguments_number - 1;
+	}
+	return offset;
+}
+
+/*
+ * A parser and its subparsers fill either variables or the fields of one
+ * record. The mode is taken from the first argument added to any of them or
+ * from a parent, and arguments of the other mode are refused from then on.
+ */
+static inline bool accepts_destinations(argparser_t argparser, bool is_record) {
+	if (is_record ? argparser->is_bound : argparser->is_record) {
+		return false;
+	}
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		if (!accepts_destinations(argparser->subparsers[i].parser, is_record)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline void bind_destinations(argparser_t argparser, bool is_record) {
+	argparser->is_record |= is_record;
+	argparser->is_bound |= !is_record;
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		bind_destinations(argparser->subparsers[i].parser, is_record);
+	}
+}
+
+static inline bool is_prefix_char(argparser_t argparser, char c) {
+	return argparser->char_class[(unsigned char)c] & CHAR_CLASS_PREFIX;
+}
@@ -1,10 +1,12 @@
 #include <buracchi/argparser/argparser.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <buracchi/common/utilities/try.h>
-#include <buracchi/common/utilities/utilities.h>
 
+#include "pool.h"
+#include "stats.h"
 #include "struct_argparser.h"
 
 extern void argparser_set_subparsers_options(argparser_t argparser,
@@ -17,45 +19,63 @@ extern argparser_t argparser_add_subparser(argparser_t argparser,
                                            const char *command_name,
                                            const char *help) {
 	struct subparser subparser;
-	struct subparser *subparsers_reallocd;
-	char *prog;
+	const char *prog;
 	subparser.selection_result = selection_result;
 	subparser.command_name = command_name;
 	subparser.help = help;
-	try(subparser.parser = argparser_init(argparser->argc, argparser->argv), nullptr, fail);
+	try(argparser->is_shared, true, fail);
+	if (argparser->subparsers_number == argparser->subparsers_capacity) {
+		size_t capacity = argparser->subparsers_capacity ? argparser->subparsers_capacity * 2 : 4;
+		struct subparser *subparsers_reallocd;
+		try(subparsers_reallocd = realloc(argparser->subparsers, sizeof *argparser->subparsers * capacity),
+		    nullptr,
+		    fail);
+		argparser->subparsers = subparsers_reallocd;
+		argparser->subparsers_capacity = capacity;
+		stats_count_allocation(argparser, sizeof *argparser->subparsers * capacity);
+	}
+	pool_begin(argparser);
 	if (argparser->subparsers_options.prog) {
-		asprintf(&prog, "%s %s", argparser->subparsers_options.prog, command_name);
+		pool_append(argparser, argparser->subparsers_options.prog, strlen(argparser->subparsers_options.prog));
 	}
 	else {
-		char *old_prog;
-		asprintf(&prog, "%s", argparser->program_name);
+		pool_append(argparser, argparser->program_name, strlen(argparser->program_name));
 		for (size_t i = 0; i < argparser->arguments_number; i++) {
 			if (argparser->arguments[i].name) {
-				old_prog = prog;
-				asprintf(&prog,
-				         "%s %s",
-				         prog,
-				         argparser->arguments[i].name);
-				free(old_prog);
+				pool_append(argparser, " ", 1);
+				pool_append(argparser, argparser->arguments[i].name, strlen(argparser->arguments[i].name));
 			}
 		}
-		old_prog = prog;
-		asprintf(&prog, "%s %s", prog, command_name);
-		free(old_prog);
 	}
-	// TODO: handle prog memory leak
-	subparser.parser->program_name = prog;
-	try(subparsers_reallocd = realloc(argparser->subparsers,
-	                                  sizeof *(argparser->subparsers) *
-	                                          (argparser->subparsers_number + 1)),
-	    nullptr,
-	    fail2);
-	argparser->subparsers = subparsers_reallocd;
-	argparser->subparsers_number++;
-	memcpy(&(argparser->subparsers[argparser->subparsers_number - 1]), &subparser, sizeof subparser);
+	pool_append(argparser, " ", 1);
+	pool_append(argparser, command_name, strlen(command_name));
+	try(prog = pool_end(argparser), nullptr, fail);
+	try(subparser.parser = pool_alloc(argparser, sizeof *subparser.parser), nullptr, fail);
+	// Everything but the arguments and the names is inherited from the parent.
+	*subparser.parser = (struct argparser){
+		.argc = argparser->argc,
+		.argv = argparser->argv,
+		.default_program_name = argparser->default_program_name,
+		.program_name = prog,
+		.arguments_number = 1,
+		.arguments_capacity = 0,
+		.arguments = (struct argparser_argument *)&builtin_help,
+		.add_help = true,
+		.exit_on_error = true,
+		.stats = argparser->stats,
+		.catalog = argparser->catalog,
+		.trace_callback = argparser->trace_callback,
+		.trace_data = argparser->trace_data,
+		.pool = argparser->pool,
+		.is_pooled = true,
+		.is_record = argparser->is_record,
+		.is_bound = argparser->is_bound,
+	};
+	memcpy(subparser.parser->char_class, argparser->char_class, sizeof argparser->char_class);
+	memcpy(subparser.parser->short_prefix, argparser->short_prefix, sizeof argparser->short_prefix);
+	memcpy(subparser.parser->long_prefix, argparser->long_prefix, sizeof argparser->long_prefix);
+	argparser->subparsers[argparser->subparsers_number++] = subparser;
 	return subparser.parser;
-fail2:
-	argparser_destroy(subparser.parser);
 fail:
 	return nullptr;
 }
@@ -0,0 +1,180 @@
+#include "suggest.h"
+
+#include <string.h>
+
+#include <buracchi/common/utilities/try.h>
+
+#include "index.h"
+
+/* The closest candidate found so far. */
+struct suggestion {
+	size_t distance; /* the maximum distance + 1 while there is none */
+	size_t rank;
+	const struct length_item *item;
+};
+
+static void consider_buckets(const struct suggest_query *query,
+                             const struct length_buckets *buckets,
+                             uint32_t first,
+                             size_t rank_base,
+                             struct suggestion *best);
+
+extern bool suggest_query_init(struct suggest_query *query, const char *pattern, size_t length) {
+	if (length == 0 || length > SUGGEST_MAX_LENGTH) {
+		return false;
+	}
+	memset(query->peq, 0, sizeof query->peq);
+	for (size_t i = 0; i < length; i++) {
+		query->peq[(unsigned char)pattern[i]] |= UINT64_C(1) << i;
+	}
+	query->length = length;
+	// One edit every four characters, short strings are too ambiguous.
+	// SUGGEST_MAX_CANDIDATE_LENGTH follows from this bound.
+	query->max_distance = (length + 1) / 4;
+	return true;
+}
+
+/*
+ * Myers' algorithm in the formulation of Hyyrö: the column of the dynamic
+ * programming matrix is kept as vertical positive and negative delta bit
+ * vectors, so each character of text costs a handful of word operations.
+ * The score tracks the last row; since every remaining character lowers it by
+ * at most one, the scan stops as soon as bound can no longer be reached.
+ */
+extern size_t suggest_distance(const struct suggest_query *query,
+                               const char *text,
+                               size_t text_length,
+                               size_t bound) {
+	const uint64_t last = UINT64_C(1) << (query->length - 1);
+	uint64_t vp = ~UINT64_C(0);
+	uint64_t vn = 0;
+	size_t score = query->length;
+	if ((text_length > query->length ? text_length - query->length : query->length - text_length) > bound) {
+		return bound + 1;
+	}
+	for (size_t j = 0; j < text_length; j++) {
+		uint64_t eq = query->peq[(unsigned char)text[j]];
+		uint64_t xv = eq | vn;
+		uint64_t xh = (((eq & vp) + vp) ^ vp) | eq;
+		uint64_t ph = vn | ~(xh | vp);
+		uint64_t mh = vp & xh;
+		if (ph & last) {
+			score++;
+		}
+		else if (mh & last) {
+			score--;
+		}
+		if (score > bound + (text_length - j - 1)) {
+			return bound + 1;
+		}
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		vp = mh | ~(xv | ph);
+		vn = ph & xv;
+	}
+	return score > bound ? bound + 1 : score;
+}
+
+extern const struct argparser_argument *suggest_flag(argparser_t argparser, const char *token) {
+	const struct argparser_argument *result = nullptr;
+	const struct argument_index *index;
+	struct suggestion best = { 0 };
+	struct suggest_query query;
+	size_t offset = argparser->arguments_number;
+	while (is_prefix_char(argparser, *token)) {
+		token++;
+	}
+	// The value of a --flag=value token is not part of the flag.
+	if (!suggest_query_init(&query, token, strcspn(token, "="))) {
+		return nullptr;
+	}
+	best.distance = query.max_distance + 1;
+	try(index = argument_index_get(argparser), nullptr, fail);
+	consider_buckets(&query, &index->long_flags, 0, 0, &best);
+	if (best.item) {
+		result = &argparser->arguments[best.item->position];
+	}
+	// The options of the parents rank after the own ones, their help excluded.
+	for (size_t i = 0; i < argparser->parents_number; i++) {
+		argparser_t parent = argparser->parents[i];
+		const struct length_item *previous_best = best.item;
+		try(index = argument_index_get(parent), nullptr, fail);
+		consider_buckets(&query, &index->long_flags, 1, offset - 1, &best);
+		if (best.item != previous_best) {
+			result = &parent->arguments[best.item->position];
+		}
+		offset += parent->arguments_number - 1;
+	}
+fail:
+	return result;
+}
+
+extern const char *suggest_subcommand(argparser_t argparser, const char *token) {
+	const struct argument_index *index;
+	struct suggestion best = { 0 };
+	struct suggest_query query;
+	if (!suggest_query_init(&query, token, strlen(token))) {
+		return nullptr;
+	}
+	best.distance = query.max_distance + 1;
+	try(index = argument_index_get(argparser), nullptr, fail);
+	consider_buckets(&query, &index->subcommands, 0, 0, &best);
+	return best.item ? best.item->key : nullptr;
+fail:
+	return nullptr;
+}
+
+/* The choices belong to the caller, they are few and scanned in order. */
+extern const char *suggest_choice(const struct argparser_argument *argument, const char *value) {
+	struct suggest_query query;
+	size_t best_distance;
+	const char *best = nullptr;
+	if (argument->choices == nullptr || !suggest_query_init(&query, value, strlen(value))) {
+		return nullptr;
+	}
+	best_distance = query.max_distance + 1;
+	for (char **choice = argument->choices; *choice; choice++) {
+		size_t distance = suggest_distance(&query, *choice, strlen(*choice), best_distance - 1);
+		if (distance > 0 && distance < best_distance) {
+			best_distance = distance;
+			best = *choice;
+		}
+	}
+	return best;
+}
+
+/*
+ * Visit the buckets from the length of the query outwards, only as far as
+ * the best distance found so far, which shrinks with every closer candidate.
+ * The items before first are skipped, the rank of an item is its position
+ * plus rank_base and the lowest rank wins ties, as a scan in registration
+ * order would.
+ */
+static void consider_buckets(const struct suggest_query *query,
+                             const struct length_buckets *buckets,
+                             uint32_t first,
+                             size_t rank_base,
+                             struct suggestion *best) {
+	for (size_t delta = 0; delta <= best->distance && delta <= query->length + buckets->buckets_number; delta++) {
+		for (int side = 0; side < 2; side++) {
+			size_t length = side ? query->length + delta : query->length - delta;
+			if ((side && delta == 0) || (!side && delta > query->length) || length >= buckets->buckets_number) {
+				continue;
+			}
+			for (uint32_t i = buckets->offsets[length]; i < buckets->offsets[length + 1]; i++) {
+				const struct length_item *item = &buckets->items[i];
+				size_t rank = rank_base + item->position;
+				// Ties are only worth computing against a worse ranked best.
+				size_t bound = (best->item && rank < best->rank) ? best->distance : best->distance - 1;
+				size_t distance;
+				if (item->position < first || delta > bound) {
+					continue;
+				}
+				distance = suggest_distance(query, item->key, length, bound);
+				if (distance > 0 && distance <= bound) {
+					*best = (struct suggestion){ .distance = distance, .rank = rank, .item = item };
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "struct_argparser.h"
+
+/*
+ * A misspelled string compiled for Myers' bit-parallel edit distance, the
+ * match masks are computed once and reused against every candidate.
+ */
+struct suggest_query {
+	uint64_t peq[256]; /* bit i set if pattern[i] is the character */
+	size_t length;
+	size_t max_distance; /* candidates farther than this are not suggested */
+};
+
+/**
+ * @brief Compile a misspelled string.
+ * @return false if the string is empty or too long to be suggested for.
+ */
+extern bool suggest_query_init(struct suggest_query *query, const char *pattern, size_t length);
+
+/**
+ * @brief Compute the edit distance between the query and text.
+ * @return the Levenshtein distance or bound + 1 if it exceeds bound.
+ */
+extern size_t suggest_distance(const struct suggest_query *query,
+                               const char *text,
+                               size_t text_length,
+                               size_t bound);
+
+/**
+ * @brief Return the optional whose long flag is closest to an unrecognized
+ * token, or nullptr if none is close enough.
+ */
+extern const struct argparser_argument *suggest_flag(argparser_t argparser, const char *token);
+
+/**
+ * @brief Return the subcommand name closest to token or nullptr.
+ */
+extern const char *suggest_subcommand(argparser_t argparser, const char *token);
+
+/**
+ * @brief Return the choice of argument closest to value or nullptr.
+ */
+extern const char *suggest_choice(const struct argparser_argument *argument, const char *value);
@@ -0,0 +1,141 @@
+#include <buracchi/argparser/argparser.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Quoting state of the byte being read, one bit of the special table each. */
+enum quoting {
+	QUOTING_NONE = 0x1,
+	QUOTING_SINGLE = 0x2,
+	QUOTING_DOUBLE = 0x4,
+};
+
+/* Bytes that end a run of literal characters in each quoting state. */
+static const uint8_t special[256] = {
+	[' '] = QUOTING_NONE,
+	['\t'] = QUOTING_NONE,
+	['\n'] = QUOTING_NONE,
+	['\''] = QUOTING_NONE | QUOTING_SINGLE,
+	['"'] = QUOTING_NONE | QUOTING_DOUBLE,
+	['\\'] = QUOTING_NONE | QUOTING_DOUBLE,
+};
+
+static size_t scan(const char *s, size_t n, enum quoting quoting);
+static size_t scan_scalar(const char *s, size_t n, enum quoting quoting);
+
+extern int argparser_tokenize(char *command, char **argv, size_t argv_size, size_t *argc) {
+	char *end = command + strlen(command);
+	char *r = command; /* next byte to read */
+	size_t tokens = 0;
+	while (true) {
+		enum quoting quoting = QUOTING_NONE;
+		char *w; /* next byte of the token to write, never past r */
+		while (r < end && (*r == ' ' || *r == '\t' || *r == '\n')) {
+			r++;
+		}
+		if (r == end) {
+			break;
+		}
+		if (tokens + 1 >= argv_size) {
+			return 1;
+		}
+		argv[tokens++] = w = r;
+		while (true) {
+			size_t span = scan(r, (size_t)(end - r), quoting);
+			char c;
+			if (w != r) {
+				memmove(w, r, span);
+			}
+			w += span;
+			r += span;
+			if (r == end) {
+				if (quoting != QUOTING_NONE) {
+					return 1;
+				}
+				break;
+			}
+			c = *r++;
+			if (quoting == QUOTING_NONE && (c == ' ' || c == '\t' || c == '\n')) {
+				break;
+			}
+			if (c == '\\') {
+				if (r == end) {
+					return 1;
+				}
+				if (*r == '\n') {
+					r++;
+				}
+				else if (quoting == QUOTING_NONE || strchr("$`\"\\", *r)) {
+					*w++ = *r++;
+				}
+				else {
+					*w++ = c;
+				}
+			}
+			else if (quoting == QUOTING_NONE) {
+				quoting = (c == '\'') ? QUOTING_SINGLE : QUOTING_DOUBLE;
+			}
+			else {
+				quoting = QUOTING_NONE;
+			}
+		}
+		*w = '\0';
+	}
+	if (argv_size == 0) {
+		return 1;
+	}
+	argv[tokens] = nullptr;
+	*argc = tokens;
+	return 0;
+}
+
+/* Return the position of the first special byte of s, n if there is none. */
+#ifdef __SSE2__
+static size_t scan(const char *s, size_t n, enum quoting quoting) {
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i hits;
+		int mask;
+		switch (quoting) {
+		case QUOTING_SINGLE:
+			hits = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\''));
+			break;
+		case QUOTING_DOUBLE:
+			hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+			                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+			break;
+		default:
+			hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+			                                 _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+			                    _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')),
+			                                 _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\''))));
+			hits = _mm_or_si128(hits,
+			                    _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+			                                 _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))));
+			break;
+		}
+		mask = _mm_movemask_epi8(hits);
+		if (mask) {
+			return i + (size_t)__builtin_ctz((unsigned int)mask);
+		}
+	}
+	return i + scan_scalar(s + i, n - i, quoting);
+}
+#else
+static size_t scan(const char *s, size_t n, enum quoting quoting) {
+	return scan_scalar(s, n, quoting);
+}
+#endif
+
+static size_t scan_scalar(const char *s, size_t n, enum quoting quoting) {
+	size_t i = 0;
+	while (i < n && !(special[(unsigned char)s[i]] & quoting)) {
+		i++;
+	}
+	return i;
+}
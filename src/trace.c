@@ -0,0 +1,47 @@
+#include "trace.h"
+
+#include <time.h>
+
+extern void argparser_set_trace_callback(argparser_t argparser,
+                                         argparser_trace_callback callback,
+                                         void *user_data) {
+	argparser->trace_callback = callback;
+	argparser->trace_data = user_data;
+	for (size_t i = 0; i < argparser->subparsers_number; i++) {
+		argparser_set_trace_callback(argparser->subparsers[i].parser, callback, user_data);
+	}
+}
+
+extern const char *argparser_trace_decision_name(enum argparser_trace_decision decision) {
+	static const char *names[] = {
+		[ARGPARSER_TRACE_POSITIONAL] = "positional",
+		[ARGPARSER_TRACE_SHORT_FLAG] = "short-flag",
+		[ARGPARSER_TRACE_LONG_FLAG] = "long-flag",
+		[ARGPARSER_TRACE_MATCH] = "match",
+		[ARGPARSER_TRACE_NO_MATCH] = "no-match",
+		[ARGPARSER_TRACE_VALUE] = "value",
+		[ARGPARSER_TRACE_SUBCOMMAND] = "subcommand",
+		[ARGPARSER_TRACE_CONVERT] = "convert",
+		[ARGPARSER_TRACE_CONVERT_FAILED] = "convert-failed",
+	};
+	return (decision <= ARGPARSER_TRACE_CONVERT_FAILED) ? names[decision] : nullptr;
+}
+
+extern void trace_emit(argparser_t argparser,
+                       size_t token_index,
+                       const char *token,
+                       enum argparser_trace_decision decision,
+                       const struct argparser_argument *argument) {
+	struct timespec ts;
+	struct argparser_trace_event event;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	event = (struct argparser_trace_event){
+		.timestamp_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec,
+		.argparser = argparser,
+		.token_index = token_index,
+		.token = token,
+		.decision = decision,
+		.argument = argument,
+	};
+	argparser->trace_callback(&event, argparser->trace_data);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "struct_argparser.h"
+
+/* Report a decision to the trace callback, if any. */
+#define trace(argparser, token_index, token, decision, argument)                            \
+	do {                                                                                \
+		if (__builtin_expect((argparser)->trace_callback != nullptr, 0)) {          \
+			trace_emit((argparser), (token_index), (token), (decision), (argument)); \
+		}                                                                           \
+	} while (0)
+
+/* Kept out of line and cold so that the fast path stays compact. */
+[[gnu::cold, gnu::noinline]] extern void trace_emit(argparser_t argparser,
+                                                    size_t token_index,
+                                                    const char *token,
+                                                    enum argparser_trace_decision decision,
+                                                    const struct argparser_argument *argument);
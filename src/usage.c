@@ -7,6 +7,7 @@
 
 #include <buracchi/common/utilities/utilities.h>
 
+#include "stats.h"
 #include "struct_argparser.h"
 
 #include "arguments.h"
@@ -32,8 +33,8 @@ extern size_t argparser_usage_size(argparser_t argparser) {
 	size_t positionals_usage_len = 0;
 	size_t subcommands_usage_size = 0;
 	const char *program_name = argparser_get_program_name(argparser);
-	for (size_t i = 0; i < argparser->arguments_number; i++) {
-		const struct argparser_argument *parg = &(argparser->arguments[i]);
+	const struct argparser_argument *parg;
+	for (struct argument_cursor cursor = { 0 }; (parg = argument_next(argparser, &cursor));) {
 		size_t str_vararg_len = get_arg_string_len(parg);
 		if (parg->name) {
 			positionals_usage_len += str_vararg_len + strlen(ARG_SEPARATOR);
@@ -41,7 +42,7 @@ extern size_t argparser_usage_size(argparser_t argparser) {
 		else {
 			optionals_usage_len +=
 				strlen(!parg->is_required ? OPTION_START_STR : "");
-			optionals_usage_len += strlen(parg->flag ? "-" : "--");
+			optionals_usage_len += strlen(parg->flag ? argparser->short_prefix : argparser->long_prefix);
 			optionals_usage_len +=
 				strlen(parg->flag ? parg->flag : parg->long_flag);
 			optionals_usage_len +=
@@ -89,9 +90,8 @@ extern int argparser_nformat_usage(argparser_t argparser, char *buffer, size_t b
 		buffer_size_remaining -= written;
 	}
 	{ // write optionals
-		for (size_t i = 0; i < argparser->arguments_number; i++) {
-			const struct argparser_argument *parg =
-				&(argparser->arguments[i]);
+		const struct argparser_argument *parg;
+		for (struct argument_cursor cursor = { 0 }; (parg = argument_next(argparser, &cursor));) {
 			char *str_vararg = get_arg_string(parg);
 			if (parg->name) {
 				continue;
@@ -101,7 +101,7 @@ extern int argparser_nformat_usage(argparser_t argparser, char *buffer, size_t b
 			                 buffer_size_remaining,
 			                 "%s%s%s%s%s%s ",
 			                 !parg->is_required ? OPTION_START_STR : "",
-			                 parg->flag ? "-" : "--",
+			                 parg->flag ? argparser->short_prefix : argparser->long_prefix,
 			                 parg->flag ? parg->flag : parg->long_flag,
 			                 str_vararg ? ARG_SEPARATOR : "",
 			                 str_vararg ? str_vararg : "",
@@ -115,9 +115,8 @@ extern int argparser_nformat_usage(argparser_t argparser, char *buffer, size_t b
 		}
 	}
 	{ // write positionals
-		for (size_t i = 0; i < argparser->arguments_number; i++) {
-			const struct argparser_argument *parg =
-				&(argparser->arguments[i]);
+		const struct argparser_argument *parg;
+		for (struct argument_cursor cursor = { 0 }; (parg = argument_next(argparser, &cursor));) {
 			char *str_vararg = get_arg_string(parg);
 			if (!parg->name) {
 				continue;
@@ -159,28 +158,36 @@ extern char *argparser_format_usage(argparser_t argparser) {
 	char *positionals_usage = nullptr;
 	char *subcommands_usage = nullptr;
 	const char *program_name = argparser_get_program_name(argparser);
-	for (size_t i = 0; i < argparser->arguments_number; i++) {
-		const struct argparser_argument *parg = &(argparser->arguments[i]);
+	enum argparser_phase previous_phase;
+	int length;
+	previous_phase = stats_enter_phase(argparser, ARGPARSER_PHASE_FORMAT);
+	const struct argparser_argument *parg;
+	for (struct argument_cursor cursor = { 0 }; (parg = argument_next(argparser, &cursor));) {
 		char *str_vararg = get_arg_string(parg);
 		char *old_usage;
+		if (str_vararg) {
+			stats_count_allocation(argparser, strlen(str_vararg) + 1);
+		}
 		if (parg->name) {
 			old_usage = positionals_usage;
-			asprintf(&positionals_usage,
-			         "%s%s ",
-			         positionals_usage ? positionals_usage : "",
-			         str_vararg);
+			length = asprintf(&positionals_usage,
+			                  "%s%s ",
+			                  positionals_usage ? positionals_usage : "",
+			                  str_vararg);
+			stats_count_allocation(argparser, (size_t)length + 1);
 		}
 		else {
 			old_usage = optionals_usage;
-			asprintf(&optionals_usage,
-			         "%s%s%s%s%s%s%s ",
-			         optionals_usage ? optionals_usage : "",
-			         !parg->is_required ? OPTION_START_STR : "",
-			         parg->flag ? "-" : "--",
-			         parg->flag ? parg->flag : parg->long_flag,
-			         str_vararg ? ARG_SEPARATOR : "",
-			         str_vararg ? str_vararg : "",
-			         !parg->is_required ? OPTION_END_STR : "");
+			length = asprintf(&optionals_usage,
+			                  "%s%s%s%s%s%s%s ",
+			                  optionals_usage ? optionals_usage : "",
+			                  !parg->is_required ? OPTION_START_STR : "",
+			                  parg->flag ? argparser->short_prefix : argparser->long_prefix,
+			                  parg->flag ? parg->flag : parg->long_flag,
+			                  str_vararg ? ARG_SEPARATOR : "",
+			                  str_vararg ? str_vararg : "",
+			                  !parg->is_required ? OPTION_END_STR : "");
+			stats_count_allocation(argparser, (size_t)length + 1);
 		}
 		free(str_vararg);
 		free(old_usage);
@@ -188,24 +195,28 @@ extern char *argparser_format_usage(argparser_t argparser) {
 	for (size_t i = 0; i < argparser->subparsers_number; i++) {
 		char *old_subcommands_usage;
 		old_subcommands_usage = subcommands_usage;
-		asprintf(&subcommands_usage,
-		         "%s%s%s%s",
-		         old_subcommands_usage ? old_subcommands_usage : SUBCOMMAND_START,
-		         argparser->subparsers[i].command_name,
-		         (i < argparser->subparsers_number - 1) ? SUBCOMMAND_SEP : "",
-		         (i == argparser->subparsers_number - 1) ?
-		                 SUBCOMMAND_END ARG_SEPARATOR "..." :
-		                 "");
+		length = asprintf(&subcommands_usage,
+		                  "%s%s%s%s",
+		                  old_subcommands_usage ? old_subcommands_usage : SUBCOMMAND_START,
+		                  argparser->subparsers[i].command_name,
+		                  (i < argparser->subparsers_number - 1) ? SUBCOMMAND_SEP : "",
+		                  (i == argparser->subparsers_number - 1) ?
+		                          SUBCOMMAND_END ARG_SEPARATOR "..." :
+		                          "");
+		stats_count_allocation(argparser, (size_t)length + 1);
 		free(old_subcommands_usage);
 	}
-	asprintf(&usage_message,
-	         "usage: %s%s%s%s%s",
-	         program_name,
-	         strlen(program_name) != 0 ? ARG_SEPARATOR : "",
-	         optionals_usage ? optionals_usage : "",
-	         positionals_usage ? positionals_usage : "",
-	         subcommands_usage ? subcommands_usage : "");
+	length = asprintf(&usage_message,
+	                  "usage: %s%s%s%s%s",
+	                  program_name,
+	                  strlen(program_name) != 0 ? ARG_SEPARATOR : "",
+	                  optionals_usage ? optionals_usage : "",
+	                  positionals_usage ? positionals_usage : "",
+	                  subcommands_usage ? subcommands_usage : "");
+	stats_count_allocation(argparser, (size_t)length + 1);
 	free(optionals_usage);
 	free(positionals_usage);
+	free(subcommands_usage);
+	stats_enter_phase(argparser, previous_phase);
 	return usage_message;
 }
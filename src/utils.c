@@ -63,3 +63,19 @@ extern bool isnumber(const char *str) {
 	}
 	return true;
 }
+
+extern bool strtobool(const char *str, bool *result) {
+	static const char *const true_strings[] = { "1", "true", "yes", "on" };
+	static const char *const false_strings[] = { "0", "false", "no", "off" };
+	for (size_t i = 0; i < sizeof true_strings / sizeof *true_strings; i++) {
+		if (strcmp(str, true_strings[i]) == 0) {
+			*result = true;
+			return true;
+		}
+		if (strcmp(str, false_strings[i]) == 0) {
+			*result = false;
+			return true;
+		}
+	}
+	return false;
+}
@@ -5,3 +5,5 @@
 extern bool basename(const char *restrict filename, size_t s, char dest[restrict s]);
 
 extern bool isnumber(const char *str);
+
+extern bool strtobool(const char *str, bool *result);
@@ -0,0 +1,70 @@
+#include "values.h"
+
+#include <string.h>
+
+#include <buracchi/common/utilities/strto.h>
+
+#include "utils.h"
+
+extern bool convert_value(enum argparser_type type, const char *arg, void *result) {
+	switch (type) {
+	case ARGPARSER_TYPE_BOOL:
+		return strtobool(arg, (bool *)result);
+	case ARGPARSER_TYPE_CSTR:
+		*(const char **)result = arg;
+		return true;
+	case ARGPARSER_TYPE_INT:
+		return cmn_strto_n((int *)result, arg) == CMN_STRTO_SUCCESS;
+	case ARGPARSER_TYPE_LONG:
+		return cmn_strto_n((long *)result, arg) == CMN_STRTO_SUCCESS;
+	case ARGPARSER_TYPE_USHORT:
+		return cmn_strto_n((unsigned short *)result, arg) == CMN_STRTO_SUCCESS;
+	case ARGPARSER_TYPE_UINT:
+		return cmn_strto_n((unsigned int *)result, arg) == CMN_STRTO_SUCCESS;
+	case ARGPARSER_TYPE_STRING_VIEW:
+		*(struct argparser_string_view *)result = (struct argparser_string_view){ arg, strlen(arg) };
+		return true;
+	default:
+		return false; // unreachable
+	}
+}
+
+extern bool is_valid_choice(const struct argparser_argument *argument, const char *value) {
+	if (argument->choices == nullptr) {
+		return true;
+	}
+	for (char **choice = argument->choices; *choice; choice++) {
+		if (strcmp(*choice, value) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+extern size_t value_size(enum argparser_type type) {
+	static const size_t sizes[] = {
+		[ARGPARSER_TYPE_BOOL] = sizeof(bool),
+		[ARGPARSER_TYPE_CSTR] = sizeof(char *),
+		[ARGPARSER_TYPE_INT] = sizeof(int),
+		[ARGPARSER_TYPE_LONG] = sizeof(long int),
+		[ARGPARSER_TYPE_USHORT] = sizeof(unsigned short int),
+		[ARGPARSER_TYPE_UINT] = sizeof(unsigned int),
+		[ARGPARSER_TYPE_STRING_VIEW] = sizeof(struct argparser_string_view),
+	};
+	return sizes[type];
+}
+
+extern bool value_equals(enum argparser_type type, const void *a, const void *b) {
+	if (type == ARGPARSER_TYPE_CSTR) {
+		const char *str_a = *(const char *const *)a;
+		const char *str_b = *(const char *const *)b;
+		return str_a == str_b || (str_a && str_b && strcmp(str_a, str_b) == 0);
+	}
+	if (type == ARGPARSER_TYPE_STRING_VIEW) {
+		const struct argparser_string_view *view_a = a;
+		const struct argparser_string_view *view_b = b;
+		return view_a->length == view_b->length &&
+		       (view_a->length == 0 || memcmp(view_a->data, view_b->data, view_a->length) == 0);
+	}
+	return memcmp(a, b, value_size(type)) == 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <buracchi/argparser/types.h>
+
+/*
+ * Storage large enough for a value of any argparser_type, every member lives
+ * at offset zero so the address of the union is the address of the value.
+ */
+union argument_value {
+	bool boolean;
+	char *cstr;
+	int int_value;
+	long int long_value;
+	unsigned short int ushort_value;
+	unsigned int uint_value;
+	struct argparser_string_view string_view;
+};
+
+/**
+ * @brief Convert a string to a value of the given type.
+ *
+ * @param type the type of the result.
+ * @param arg the string to convert.
+ * @param result where to store the converted value, left untouched on failure.
+ * @return true on success, false if arg is not a valid representation.
+ */
+extern bool convert_value(enum argparser_type type, const char *arg, void *result);
+
+/**
+ * @brief Return true if value is one of the choices of argument, or if the
+ * argument does not restrict its values.
+ */
+extern bool is_valid_choice(const struct argparser_argument *argument, const char *value);
+
+extern size_t value_size(enum argparser_type type);
+
+extern bool value_equals(enum argparser_type type, const void *a, const void *b);
@@ -1,6 +1,8 @@
 #include <buracchi/cutest/cutest.h>
 
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <buracchi/argparser/argparser.h>
 
@@ -117,3 +119,977 @@ TEST(argparser, optional_args_are_position_independent) {
 	argparser_destroy(argparser);
 	ASSERT_EQ(result, true);
 }
+
+TEST(argparser, config_file_between_defaults_and_command_line) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *config_path = "test_argparser_config.ini";
+	FILE *config_file = fopen(config_path, "w");
+	char *foo;
+	char *bar;
+	int count = 0;
+	bool verbose = false;
+	bool result = true;
+	argparser_t argparser;
+	fputs("# comment\n"
+	      "foo = from config\n"
+	      "bar=  1 2  \n"
+	      "\n"
+	      "max_count = 42\n"
+	      "verbose",
+	      config_file);
+	fclose(config_file);
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &foo, { .flag = "f", .long_flag = "foo" });
+	argparser_add_argument(argparser, &bar, { .long_flag = "bar" });
+	argparser_add_argument(argparser, &count, { .long_flag = "max-count", .is_required = true });
+	argparser_add_argument_action_store_true(argparser,
+	                                         &verbose,
+	                                         (struct argparser_argument){ .flag = "v",
+	                                                                      .long_flag = "verbose" });
+	argparser_set_config_file(argparser, config_path);
+	argparser_parse_args(argparser, ((char *[]){ "-f", "from command line" }));
+	result &= !strcmp(foo, "from command line");
+	result &= !strcmp(bar, "1 2");
+	result &= (count == 42);
+	result &= verbose;
+	argparser_destroy(argparser);
+	remove(config_path);
+	ASSERT_EQ(result, true);
+}
+
+TEST(argparser, long_flag_named_as_positional_is_matched) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char *file_positional;
+	char *file_option;
+	char *target;
+	char *output;
+	bool result = true;
+	argparser_t argparser;
+	argparser_t parent;
+	argparser_t child;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &file_positional, { .name = "file" });
+	argparser_add_argument(argparser, &file_option, { .long_flag = "file" });
+	argparser_parse_args(argparser, ((char *[]){ "x", "--file", "y" }));
+	result &= !strcmp(file_positional, "x") && !strcmp(file_option, "y");
+	argparser_destroy(argparser);
+	parent = argparser_init(argc, argv);
+	argparser_add_argument(parent, &output, { .long_flag = "output" });
+	child = argparser_init(argc, argv);
+	argparser_add_argument(child, &target, { .name = "output" });
+	argparser_add_parent(child, parent);
+	argparser_parse_args(child, ((char *[]){ "--output", "y", "x" }));
+	result &= !strcmp(target, "x") && !strcmp(output, "y");
+	argparser_destroy(child);
+	argparser_destroy(parent);
+	ASSERT_EQ(result, true);
+}
+
+TEST(argparser, index_probes_wrap_and_tell_colliding_keys_apart) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char *beta;
+	char *zeta;
+	char *eta;
+	char *dash;
+	char *underscore;
+	char *count_option;
+	char *count_positional;
+	char *leftovers[2];
+	size_t leftovers_number;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	// With the help option the index has 8 slots and these keys all hash to the last one.
+	argparser_add_argument(argparser, &beta, { .long_flag = "beta" });
+	argparser_add_argument(argparser, &zeta, { .long_flag = "zeta" });
+	argparser_add_argument(argparser, &eta, { .long_flag = "eta" });
+	ASSERT_EQ(argparser_parse_known_args(argparser, ((const char *[]){ "--eta", "1", "--zeta", "2", "--beta", "3", "--mu" }), 7, leftovers, &leftovers_number), 0);
+	ASSERT_EQ(strcmp(eta, "1") == 0 && strcmp(zeta, "2") == 0 && strcmp(beta, "3") == 0, true);
+	ASSERT_EQ(leftovers_number == 1 && strcmp(leftovers[0], "--mu") == 0, true);
+	argparser_destroy(argparser);
+	argparser = argparser_init(argc, argv);
+	// Hashes fold '_' into '-', so these keys agree on every field of their slots.
+	argparser_add_argument(argparser, &dash, { .long_flag = "max-count" });
+	argparser_add_argument(argparser, &underscore, { .long_flag = "max_count" });
+	argparser_add_argument(argparser, &count_positional, { .name = "count" });
+	argparser_add_argument(argparser, &count_option, { .long_flag = "count" });
+	ASSERT_EQ(argparser_parse_args(argparser, ((const char *[]){ "--max_count", "1", "c", "--max-count", "2", "--count", "3" }), 7), 0);
+	ASSERT_EQ(strcmp(underscore, "1") == 0 && strcmp(dash, "2") == 0, true);
+	ASSERT_EQ(strcmp(count_option, "3") == 0 && strcmp(count_positional, "c") == 0, true);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, config_reload_publishes_snapshot_with_changes) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *config_path = "test_argparser_reload.ini";
+	FILE *config_file = fopen(config_path, "w");
+	char *foo;
+	int count = 0;
+	int limit = 0;
+	const struct argparser_snapshot *snapshot;
+	const struct argparser_argument *changed;
+	size_t position = 0;
+	size_t generation;
+	bool result = true;
+	argparser_t argparser;
+	fputs("foo = a\ncount = 1\nlimit = 10\n", config_file);
+	fclose(config_file);
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &foo, { .long_flag = "foo" });
+	argparser_add_argument(argparser, &count, { .long_flag = "count" });
+	argparser_add_argument(argparser, &limit, { .long_flag = "limit" });
+	argparser_set_config_file(argparser, config_path);
+	argparser_enable_config_reload(argparser);
+	argparser_parse_args(argparser, ((char *[]){ "--limit", "5" }));
+	result &= (argparser_config_watch(argparser) != -1);
+	config_file = fopen(config_path, "w");
+	fputs("foo = a\ncount = 2\nlimit = 20\n", config_file);
+	fclose(config_file);
+	result &= (argparser_config_poll(argparser) == 0);
+	snapshot = argparser_config_snapshot(argparser);
+	result &= !strcmp(*(char *const *)argparser_snapshot_get(snapshot, &foo), "a");
+	result &= (*(const int *)argparser_snapshot_get(snapshot, &count) == 2);
+	result &= (*(const int *)argparser_snapshot_get(snapshot, &limit) == 5);
+	result &= (count == 1);
+	result &= (argparser_snapshot_changes_number(snapshot) == 1);
+	changed = argparser_snapshot_next_change(snapshot, &position);
+	result &= (changed && !strcmp(changed->long_flag, "count"));
+	result &= (argparser_snapshot_next_change(snapshot, &position) == nullptr);
+	config_file = fopen(config_path, "w");
+	fputs("count = many\n", config_file);
+	fclose(config_file);
+	generation = argparser_snapshot_generation(snapshot);
+	result &= (argparser_config_reload(argparser) == 1);
+	result &= (argparser_config_snapshot(argparser) == snapshot);
+	config_file = fopen(config_path, "w");
+	fputs("count = 3\n", config_file);
+	fclose(config_file);
+	result &= (argparser_config_reload(argparser) == 0);
+	result &= argparser_snapshot_validate(snapshot, generation);
+	result &= (argparser_config_reload(argparser) == 0);
+	result &= !argparser_snapshot_validate(snapshot, generation);
+	result &= argparser_snapshot_validate(argparser_config_snapshot(argparser),
+	                                      argparser_snapshot_generation(argparser_config_snapshot(argparser)));
+	argparser_destroy(argparser);
+	remove(config_path);
+	ASSERT_EQ(result, true);
+}
+
+TEST(argparser, stats_count_tokens_hops_and_allocations) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char *foo = nullptr;
+	char *bar = nullptr;
+	const char *command = nullptr;
+	const char *config_path = "test_argparser_stats.ini";
+	FILE *config_file;
+	struct argparser_stats stats;
+	argparser_t argparser;
+	argparser_t subparser;
+	argparser = argparser_init(argc, argv);
+	argparser_enable_stats(argparser);
+	argparser_add_argument(argparser, &foo, { .long_flag = "foo" });
+	subparser = argparser_add_subparser(argparser, &command, "run", nullptr);
+	argparser_add_argument(subparser, &bar, { .long_flag = "bar" });
+	argparser_parse_args(argparser, ((char *[]){ "--foo", "1", "run", "--bar", "2" }));
+	free(argparser_format_help(argparser));
+	stats = argparser_get_stats(argparser);
+	argparser_reset_stats(argparser);
+	ASSERT_EQ(stats.tokens, 5);
+	ASSERT_EQ(stats.subcommand_hops, 1);
+	ASSERT_EQ(stats.lookups >= 2, true);
+	ASSERT_EQ(stats.allocations > 0, true);
+	ASSERT_EQ(stats.phase_ns[ARGPARSER_PHASE_FORMAT] > 0, true);
+	ASSERT_EQ(argparser_get_stats(argparser).tokens, 0);
+	config_file = fopen(config_path, "w");
+	fputs("foo = 3\n", config_file);
+	fclose(config_file);
+	argparser_set_config_file(argparser, config_path);
+	remove(config_path);
+	// The source and its entries.
+	ASSERT_EQ(argparser_get_stats(argparser).allocations, 2);
+	argparser_destroy(argparser);
+	ASSERT_EQ(strcmp(foo, "1") == 0 && strcmp(bar, "2") == 0, true);
+}
+
+static void record_decision(const struct argparser_trace_event *event, void *user_data) {
+	char *decisions = user_data;
+	decisions[event->token_index * 8 + strlen(decisions + event->token_index * 8)] =
+		(char)('0' + event->decision);
+}
+
+TEST(argparser, trace_reports_token_decisions) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char *arg = nullptr;
+	int count = 0;
+	char decisions[3][8] = { 0 };
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_set_trace_callback(argparser, record_decision, decisions);
+	argparser_add_argument(argparser, &arg, { .name = "arg" });
+	argparser_add_argument(argparser, &count, { .long_flag = "count" });
+	argparser_parse_args(argparser, ((char *[]){ "test", "--count", "3" }));
+	argparser_destroy(argparser);
+	ASSERT_EQ(strcmp(decisions[0], (char[]){ '0' + ARGPARSER_TRACE_POSITIONAL,
+	                                         '0' + ARGPARSER_TRACE_MATCH,
+	                                         '0' + ARGPARSER_TRACE_CONVERT,
+	                                         '\0' }),
+	          0);
+	ASSERT_EQ(strcmp(decisions[1], (char[]){ '0' + ARGPARSER_TRACE_LONG_FLAG, '0' + ARGPARSER_TRACE_MATCH, '\0' }),
+	          0);
+	ASSERT_EQ(strcmp(decisions[2], (char[]){ '0' + ARGPARSER_TRACE_VALUE, '0' + ARGPARSER_TRACE_CONVERT, '\0' }),
+	          0);
+	ASSERT_EQ(count, 3);
+}
+
+TEST(argparser, unrecognized_flag_suggests_closest_option) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	bool verbose = false;
+	char output[512] = { 0 };
+	size_t length = 0;
+	ssize_t n;
+	int fds[2];
+	int status;
+	pid_t pid;
+	ASSERT_EQ(pipe(fds), 0);
+	pid = fork();
+	if (pid == 0) {
+		argparser_t argparser;
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		argparser = argparser_init(argc, argv);
+		argparser_add_argument_action_store_true(argparser,
+		                                         &verbose,
+		                                         (struct argparser_argument){ .long_flag = "verbose" });
+		argparser_add_argument_action_store_true(argparser,
+		                                         &verbose,
+		                                         (struct argparser_argument){ .long_flag = "version" });
+		argparser_parse_args(argparser, ((char *[]){ "--verbos" }));
+		_exit(EXIT_SUCCESS);
+	}
+	close(fds[1]);
+	while ((n = read(fds[0], output + length, sizeof output - 1 - length)) > 0) {
+		length += (size_t)n;
+	}
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+	ASSERT_EQ(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE, true);
+	ASSERT_EQ(strstr(output, "--verbos (maybe you meant '--verbose'?)") != nullptr, true);
+}
+
+TEST(argparser, prefix_chars_select_optionals) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char *foo = nullptr;
+	char *bar = nullptr;
+	char *arg = nullptr;
+	char *usage;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_set_program_name(argparser, "prog");
+	ASSERT_EQ(argparser_set_prefix_chars(argparser, ""), 1);
+	ASSERT_EQ(argparser_set_prefix_chars(argparser, "+/"), 0);
+	argparser_add_argument(argparser, &arg, { .name = "arg" });
+	argparser_add_argument(argparser, &foo, { .flag = "f", .long_flag = "foo" });
+	argparser_add_argument(argparser, &bar, { .long_flag = "bar" });
+	argparser_parse_args(argparser, ((char *[]){ "-x", "+f", "1", "//bar", "2" }));
+	usage = argparser_format_usage(argparser);
+	argparser_destroy(argparser);
+	ASSERT_EQ(strcmp(arg, "-x"), 0);
+	ASSERT_EQ(strcmp(foo, "1"), 0);
+	ASSERT_EQ(strcmp(bar, "2"), 0);
+	ASSERT_EQ(strcmp(usage, "usage: prog [+h] [+f FOO] [++bar BAR] arg "), 0);
+	free(usage);
+}
+
+TEST(argparser, short_flags_cluster_and_count) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	int verbosity = -1;
+	bool extract = false;
+	bool gzip = false;
+	char *file = nullptr;
+	char *level = nullptr;
+	char *leftovers[2];
+	size_t leftovers_number = 0;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_count(argparser, &verbosity, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument_action_store_true(argparser, &extract, (struct argparser_argument){ .flag = "x" });
+	argparser_add_argument_action_store_true(argparser, &gzip, (struct argparser_argument){ .flag = "z" });
+	argparser_add_argument(argparser, &file, { .flag = "f" });
+	argparser_add_argument(argparser, &level, { .flag = "l" });
+	argparser_parse_args(argparser, ((char *[]){ "-vvv", "-xzf", "archive.tar", "-v", "-zl9" }));
+	ASSERT_EQ(verbosity, 4);
+	ASSERT_EQ(extract && gzip, true);
+	ASSERT_EQ(strcmp(file, "archive.tar"), 0);
+	ASSERT_EQ(strcmp(level, "9"), 0);
+	// The unknown q leaves v untouched.
+	ASSERT_EQ(argparser_parse_known_args(argparser, ((const char *[]){ "-vq" }), 1, leftovers, &leftovers_number), 0);
+	argparser_destroy(argparser);
+	ASSERT_EQ(verbosity, 0);
+	ASSERT_EQ(leftovers_number == 1 && strcmp(leftovers[0], "-vq") == 0, true);
+}
+
+TEST(argparser, parse_known_args_compacts_leftovers_in_place) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char *args[] = { "--unknown", "-v", "exec", "--", "-v", "rest", nullptr };
+	size_t leftovers_number = 0;
+	bool verbose = false;
+	char *command = nullptr;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_store_true(argparser, &verbose, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument(argparser, &command, { .name = "command" });
+	ASSERT_EQ(argparser_parse_known_args(argparser, (const char **)args, 6, args, &leftovers_number), 0);
+	argparser_destroy(argparser);
+	ASSERT_EQ(verbose, true);
+	ASSERT_EQ(strcmp(command, "exec"), 0);
+	ASSERT_EQ(leftovers_number, 3);
+	ASSERT_EQ(strcmp(args[0], "--unknown"), 0);
+	ASSERT_EQ(strcmp(args[1], "-v"), 0);
+	ASSERT_EQ(strcmp(args[2], "rest"), 0);
+	ASSERT_EQ(args[3] == nullptr, true);
+}
+
+TEST(argparser, parse_options_stops_at_first_operand) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *args[] = { "-v", "--jobs", "4", "file", "--unknown", "-v" };
+	const char *terminated[] = { "-v", "--", "-file" };
+	size_t first_operand = 0;
+	int verbosity;
+	char *jobs = nullptr;
+	char *files = nullptr;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_count(argparser, &verbosity, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument(argparser, &jobs, { .long_flag = "jobs" });
+	argparser_add_argument(argparser, &files, { .name = "files" });
+	ASSERT_EQ(argparser_parse_options(argparser, args, 6, &first_operand), 0);
+	ASSERT_EQ(first_operand, 3);
+	ASSERT_EQ(verbosity, 1);
+	ASSERT_EQ(strcmp(jobs, "4"), 0);
+	ASSERT_EQ(argparser_parse_options(argparser, terminated, 3, &first_operand), 0);
+	ASSERT_EQ(first_operand, 2);
+	argparser_destroy(argparser);
+	ASSERT_EQ(files == nullptr, true);
+}
+
+TEST(argparser, stream_reports_events_per_token) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *tokens[] = { "-vv", "--level", "3", "run", "--bogus" };
+	enum argparser_event_type types[16];
+	enum argparser_stream_error errors[16];
+	size_t events_number = 0;
+	struct argparser_event event;
+	int verbosity;
+	int level = 0;
+	char *target = nullptr;
+	const char *command = nullptr;
+	argparser_t argparser;
+	argparser_t subparser;
+	argparser_stream_t stream;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_count(argparser, &verbosity, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument(argparser, &level, { .long_flag = "level" });
+	subparser = argparser_add_subparser(argparser, &command, "run", nullptr);
+	argparser_add_argument(subparser, &target, { .name = "target" });
+	stream = argparser_stream_init(argparser);
+	for (size_t i = 0; i < sizeof tokens / sizeof *tokens; i++) {
+		ASSERT_EQ(argparser_stream_feed(stream, tokens[i]), 0);
+		while (argparser_next_event(stream, &event)) {
+			types[events_number] = event.type;
+			errors[events_number++] = event.error;
+		}
+	}
+	ASSERT_EQ(verbosity, 2);
+	ASSERT_EQ(level, 3);
+	ASSERT_EQ(strcmp(command, "run"), 0);
+	ASSERT_EQ(argparser_stream_finish(stream), 0);
+	ASSERT_EQ(argparser_stream_feed(stream, "late"), 1);
+	while (argparser_next_event(stream, &event)) {
+		types[events_number] = event.type;
+		errors[events_number++] = event.error;
+	}
+	argparser_stream_destroy(stream);
+	argparser_destroy(argparser);
+	ASSERT_EQ(events_number, 8);
+	ASSERT_EQ(types[0] == ARGPARSER_EVENT_OPTION && types[1] == ARGPARSER_EVENT_OPTION, true);
+	ASSERT_EQ(types[2] == ARGPARSER_EVENT_OPTION && types[3] == ARGPARSER_EVENT_VALUE, true);
+	ASSERT_EQ(types[4], ARGPARSER_EVENT_SUBCOMMAND);
+	ASSERT_EQ(errors[5], ARGPARSER_STREAM_ERROR_UNRECOGNIZED);
+	ASSERT_EQ(errors[6], ARGPARSER_STREAM_ERROR_MISSING_REQUIRED);
+	ASSERT_EQ(types[7], ARGPARSER_EVENT_END);
+}
+
+TEST(argparser, stream_starts_from_the_defaults) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	int verbosity = 0;
+	int level = 0;
+	bool quiet = false;
+	argparser_t argparser;
+	argparser_stream_t stream;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_count(argparser, &verbosity, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument_action_store_true(argparser, &quiet, (struct argparser_argument){ .flag = "q" });
+	argparser_add_argument(argparser, &level, { .long_flag = "level", .default_value = &(int){ 7 } });
+	argparser_parse_args(argparser, ((char *[]){ "-vvvq", "--level", "3" }));
+	stream = argparser_stream_init(argparser);
+	ASSERT_EQ(argparser_stream_feed(stream, "-v"), 0);
+	ASSERT_EQ(argparser_stream_finish(stream), 0);
+	argparser_stream_destroy(stream);
+	argparser_destroy(argparser);
+	ASSERT_EQ(verbosity, 1);
+	ASSERT_EQ(quiet, false);
+	ASSERT_EQ(level, 7);
+}
+
+TEST(argparser, stream_rejects_list_positionals) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	char **sources;
+	char *destination;
+	const char *command = nullptr;
+	argparser_t argparser;
+	argparser_t subparser;
+	argparser_stream_t stream;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &destination, { .name = "dst" });
+	subparser = argparser_add_subparser(argparser, &command, "copy", nullptr);
+	stream = argparser_stream_init(subparser);
+	ASSERT_EQ(stream != nullptr, true);
+	argparser_stream_destroy(stream);
+	argparser_add_argument(subparser, &sources, { .name = "src", .action_nargs = ARGPARSER_ACTION_NARGS_LIST });
+	ASSERT_EQ(argparser_stream_init(subparser) == nullptr, true);
+	ASSERT_EQ(argparser_stream_init(argparser) == nullptr, true);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, tokenize_splits_quoted_command_in_place) {
+	char command[] = " --name 'hello  world' a\"b\\\"c\"d \"\" e\\ f\\\n"
+	                 "g 'a long single quoted token spanning more than sixteen bytes'";
+	char unterminated[] = "--name \"open";
+	char *tokens[8];
+	char *small[2];
+	size_t tokens_number;
+	ASSERT_EQ(argparser_tokenize(command, tokens, 8, &tokens_number), 0);
+	ASSERT_EQ(tokens_number, 6);
+	ASSERT_EQ(strcmp(tokens[0], "--name"), 0);
+	ASSERT_EQ(strcmp(tokens[1], "hello  world"), 0);
+	ASSERT_EQ(strcmp(tokens[2], "ab\"cd"), 0);
+	ASSERT_EQ(strcmp(tokens[3], ""), 0);
+	ASSERT_EQ(strcmp(tokens[4], "e fg"), 0);
+	ASSERT_EQ(strcmp(tokens[5], "a long single quoted token spanning more than sixteen bytes"), 0);
+	ASSERT_EQ(tokens[6] == nullptr, true);
+	ASSERT_EQ(tokens[0] >= command && tokens[5] < command + sizeof command, true);
+	ASSERT_EQ(argparser_tokenize(unterminated, tokens, 8, &tokens_number), 1);
+	ASSERT_EQ(argparser_tokenize((char[]){ "a b" }, small, 2, &tokens_number), 1);
+}
+
+TEST(argparser, parse_buffer_walks_nul_separated_tokens) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	static const char buffer[] = "-v\0--name\0joe\0run\0-j\0" "4\0target";
+	int verbosity;
+	char *name = nullptr;
+	char *command = nullptr;
+	char *jobs = nullptr;
+	char *target = nullptr;
+	argparser_t argparser;
+	argparser_t subparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_count(argparser, &verbosity, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument(argparser, &name, { .long_flag = "name" });
+	subparser = argparser_add_subparser(argparser, &command, "run", nullptr);
+	argparser_add_argument(subparser, &jobs, { .flag = "j" });
+	argparser_add_argument(subparser, &target, { .name = "target" });
+	ASSERT_EQ(argparser_parse_buffer(argparser, buffer, sizeof buffer - 1), 1);
+	ASSERT_EQ(argparser_parse_buffer(argparser, buffer, sizeof buffer), 0);
+	argparser_destroy(argparser);
+	ASSERT_EQ(verbosity, 1);
+	ASSERT_EQ(strcmp(name, "joe"), 0);
+	ASSERT_EQ(strcmp(command, "run"), 0);
+	ASSERT_EQ(strcmp(jobs, "4"), 0);
+	ASSERT_EQ(strcmp(target, "target"), 0);
+	ASSERT_EQ(name > buffer && target < buffer + sizeof buffer, true);
+}
+
+TEST(argparser, limits_fail_fast_with_structured_error) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *args[] = { "--name", "a-rather-long-name", "run", "target" };
+	static const char buffer[] = "--name\0joe\0run\0target";
+	char *name = nullptr;
+	char *command = nullptr;
+	char *target = nullptr;
+	struct argparser_limit_error error;
+	argparser_t argparser;
+	argparser_t subparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &name, { .long_flag = "name" });
+	subparser = argparser_add_subparser(argparser, &command, "run", nullptr);
+	argparser_add_argument(subparser, &target, { .name = "target" });
+	argparser_set_limits(argparser, (struct argparser_limits){ .max_tokens = 3 });
+	ASSERT_EQ(argparser_parse_args(argparser, args, 4), 1);
+	error = argparser_get_limit_error(argparser);
+	ASSERT_EQ(error.limit, ARGPARSER_LIMIT_TOKENS);
+	ASSERT_EQ(error.token_index, 3);
+	ASSERT_EQ(argparser_parse_buffer(argparser, buffer, sizeof buffer), 1);
+	ASSERT_EQ(argparser_get_limit_error(argparser).limit, ARGPARSER_LIMIT_TOKENS);
+	argparser_set_limits(argparser, (struct argparser_limits){ .max_token_length = 8 });
+	ASSERT_EQ(argparser_parse_args(argparser, args, 4), 1);
+	error = argparser_get_limit_error(argparser);
+	ASSERT_EQ(error.limit == ARGPARSER_LIMIT_TOKEN_LENGTH && error.maximum == 8, true);
+	ASSERT_EQ(error.token_index, 1);
+	argparser_set_limits(argparser, (struct argparser_limits){ .max_total_bytes = 16 });
+	ASSERT_EQ(argparser_parse_buffer(argparser, buffer, sizeof buffer), 1);
+	ASSERT_EQ(argparser_get_limit_error(argparser).limit, ARGPARSER_LIMIT_TOTAL_BYTES);
+	argparser_set_limits(argparser, (struct argparser_limits){ .max_subcommand_depth = 0, .max_scratch_bytes = 1 });
+	ASSERT_EQ(argparser_parse_args(argparser, args, 4), 1);
+	ASSERT_EQ(argparser_get_limit_error(argparser).limit, ARGPARSER_LIMIT_SCRATCH_BYTES);
+	ASSERT_EQ(name == nullptr && command == nullptr, true);
+	argparser_set_limits(argparser, (struct argparser_limits){ .max_tokens = 4, .max_total_bytes = 64 });
+	ASSERT_EQ(argparser_parse_args(argparser, args, 4), 0);
+	ASSERT_EQ(argparser_get_limit_error(argparser).limit, ARGPARSER_LIMIT_NONE);
+	ASSERT_EQ(strcmp(target, "target"), 0);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, long_flag_takes_value_after_equals_as_view) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *args[] = { "--name=joe=smith", "--level=", "-ttag", "--quiet=yes" };
+	struct argparser_string_view name = { 0 };
+	struct argparser_string_view tag = { 0 };
+	char *level = nullptr;
+	bool quiet;
+	char *leftovers[5];
+	size_t leftovers_number;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &name, { .long_flag = "name" });
+	argparser_add_argument(argparser, &level, { .long_flag = "level" });
+	argparser_add_argument(argparser, &tag, { .flag = "t" });
+	argparser_add_argument_action_store_true(argparser, &quiet, (struct argparser_argument){ .long_flag = "quiet" });
+	ASSERT_EQ(argparser_parse_known_args(argparser, args, 4, leftovers, &leftovers_number), 0);
+	argparser_destroy(argparser);
+	ASSERT_EQ(name.data == args[0] + 7 && name.length == 9, true);
+	ASSERT_EQ(strncmp(name.data, "joe=smith", name.length), 0);
+	ASSERT_EQ(strcmp(level, ""), 0);
+	ASSERT_EQ(tag.data == args[2] + 2 && tag.length == 3, true);
+	ASSERT_EQ(leftovers_number, 1);
+	ASSERT_EQ(strcmp(leftovers[0], "--quiet=yes"), 0);
+	ASSERT_EQ(quiet, false);
+}
+
+TEST(argparser, positional_lists_take_tokens_greedily) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *args[] = { "a", "-v", "b", "c", "d" };
+	const char *short_args[] = { "a", "b", "move" };
+	char **sources = nullptr;
+	char *destination = nullptr;
+	char *mode = nullptr;
+	bool verbose;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &sources, { .name = "src" });
+	argparser_add_argument(argparser, &destination, { .name = "dst" });
+	argparser_add_argument(argparser,
+	                       &mode,
+	                       { .name = "mode", .action_nargs = ARGPARSER_ACTION_NARGS_OPTIONAL, .default_value = (void **)"copy" });
+	argparser_add_argument_action_store_true(argparser, &verbose, (struct argparser_argument){ .flag = "v" });
+	ASSERT_EQ(argparser_parse_args(argparser, args, 5), 0);
+	ASSERT_EQ(verbose, true);
+	ASSERT_EQ(strcmp(sources[0], "a") || strcmp(sources[1], "b") || strcmp(sources[2], "c"), 0);
+	ASSERT_EQ(sources[3] == nullptr, true);
+	ASSERT_EQ(strcmp(destination, "d"), 0);
+	ASSERT_EQ(strcmp(mode, "copy"), 0);
+	ASSERT_EQ(argparser_parse_args(argparser, short_args, 3), 0);
+	ASSERT_EQ(strcmp(sources[0], "a") == 0 && strcmp(sources[1], "b") == 0 && sources[2] == nullptr, true);
+	ASSERT_EQ(strcmp(destination, "move") == 0 && strcmp(mode, "copy") == 0, true);
+	argparser_destroy(argparser);
+}
+
+struct record_options {
+	int verbosity;
+	int level;
+	char *name;
+	bool quiet;
+};
+
+TEST(argparser, parse_record_fills_one_struct_per_command) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *commands[][4] = {
+		{ "-vv", "--level", "3", "joe" },
+		{ "--quiet", "ann", "--level", "5" },
+	};
+	struct record_options records[2] = { 0 };
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_field(argparser, struct record_options, verbosity, { .flag = "v", .action = ARGPARSER_ACTION_COUNT });
+	argparser_add_field(argparser, struct record_options, level, { .long_flag = "level" });
+	argparser_add_field(argparser, struct record_options, name, { .name = "name" });
+	argparser_add_field(argparser, struct record_options, quiet, { .long_flag = "quiet", .action = ARGPARSER_ACTION_STORE_TRUE });
+	ASSERT_EQ(argparser_parse_args(argparser, commands[0], 4), 1);
+	ASSERT_EQ(argparser_stream_init(argparser) == nullptr, true);
+	for (size_t i = 0; i < 2; i++) {
+		ASSERT_EQ(argparser_parse_record(argparser, commands[i], 4, &records[i]), 0);
+	}
+	argparser_destroy(argparser);
+	ASSERT_EQ(records[0].verbosity == 2 && records[0].level == 3 && !records[0].quiet, true);
+	ASSERT_EQ(strcmp(records[0].name, "joe"), 0);
+	ASSERT_EQ(records[1].verbosity == 0 && records[1].level == 5 && records[1].quiet, true);
+	ASSERT_EQ(strcmp(records[1].name, "ann"), 0);
+}
+
+struct record_copy {
+	char **sources;
+	char *destination;
+};
+
+TEST(argparser, parse_record_keeps_the_lists_of_every_record) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *commands[][3] = {
+		{ "a", "b", "dir" },
+		{ "c", "d", "e" },
+	};
+	struct record_copy records[2] = { 0 };
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_field(argparser,
+	                    struct record_copy,
+	                    sources,
+	                    { .name = "src", .action_nargs = ARGPARSER_ACTION_NARGS_LIST });
+	argparser_add_field(argparser, struct record_copy, destination, { .name = "dst" });
+	for (size_t i = 0; i < 2; i++) {
+		ASSERT_EQ(argparser_parse_record(argparser, commands[i], 3, &records[i]), 0);
+	}
+	ASSERT_EQ(strcmp(records[0].sources[0], "a") == 0 && strcmp(records[0].sources[1], "b") == 0, true);
+	ASSERT_EQ(records[0].sources[2] == nullptr && strcmp(records[0].destination, "dir") == 0, true);
+	ASSERT_EQ(strcmp(records[1].sources[0], "c") == 0 && strcmp(records[1].sources[1], "d") == 0, true);
+	ASSERT_EQ(records[1].sources[2] == nullptr && strcmp(records[1].destination, "e") == 0, true);
+	argparser_destroy(argparser);
+}
+
+struct record_command {
+	int threads;
+	bool verbose;
+	int jobs;
+	bool color;
+	char *name;
+	int retries;
+};
+
+TEST(argparser, parse_record_resets_only_the_fields_of_each_parser) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *command;
+	struct record_command record;
+	argparser_t argparser;
+	argparser_t common;
+	argparser_t run;
+	argparser = argparser_init(argc, argv);
+	common = argparser_init(argc, argv);
+	argparser_add_field(common, struct record_command, verbose, { .long_flag = "verbose", .action = ARGPARSER_ACTION_STORE_TRUE });
+	argparser_add_field(common, struct record_command, color, { .long_flag = "color", .action = ARGPARSER_ACTION_STORE_TRUE });
+	argparser_add_field(argparser, struct record_command, jobs, { .long_flag = "jobs", .default_value = &(int){ 4 } });
+	argparser_add_field(argparser, struct record_command, name, { .long_flag = "name" });
+	ASSERT_EQ(argparser_add_parent(argparser, common), 0);
+	run = argparser_add_subparser(argparser, &command, "run", nullptr);
+	argparser_add_field(run, struct record_command, threads, { .long_flag = "threads" });
+	argparser_add_field(run, struct record_command, retries, { .long_flag = "retries", .default_value = &(int){ 2 } });
+	argparser_add_subparser(argparser, &command, "stop", nullptr);
+	record = (struct record_command){ .threads = 9, .retries = 9 };
+	ASSERT_EQ(argparser_parse_record(argparser, (const char *[]){ "--name", "x", "--color", "stop" }, 4, &record), 0);
+	ASSERT_EQ(record.jobs == 4 && record.color && !record.verbose && strcmp(record.name, "x") == 0, true);
+	ASSERT_EQ(record.threads == 9 && record.retries == 9 && strcmp(command, "stop") == 0, true);
+	ASSERT_EQ(argparser_parse_record(argparser, (const char *[]){ "--name", "y", "--jobs", "1", "run", "--threads", "3" }, 7, &record), 0);
+	ASSERT_EQ(record.jobs == 1 && !record.color && strcmp(record.name, "y") == 0, true);
+	ASSERT_EQ(record.threads == 3 && record.retries == 2 && strcmp(command, "run") == 0, true);
+	argparser_destroy(argparser);
+	argparser_destroy(common);
+}
+
+TEST(argparser, record_mode_is_not_mixed_with_variables) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *command;
+	int jobs;
+	int level;
+	struct argparser_argument spec = { .long_flag = "level", .type = ARGPARSER_TYPE_INT, .destination = (void **)&level };
+	argparser_t records;
+	argparser_t variables;
+	argparser_t common;
+	argparser_t run;
+	records = argparser_init(argc, argv);
+	variables = argparser_init(argc, argv);
+	common = argparser_init(argc, argv);
+	run = argparser_add_subparser(records, &command, "run", nullptr);
+	ASSERT_EQ(argparser_add_field(run, struct record_command, threads, { .long_flag = "threads" }), 0);
+	ASSERT_EQ(argparser_add_argument(records, &jobs, { .long_flag = "jobs" }), 1);
+	ASSERT_EQ(argparser_add_arguments(records, &spec, 1), 1);
+	ASSERT_EQ(argparser_add_field(records, struct record_command, jobs, { .long_flag = "jobs" }), 0);
+	ASSERT_EQ(argparser_add_argument(argparser_add_subparser(records, &command, "stop", nullptr), &jobs, { .long_flag = "jobs" }), 1);
+	ASSERT_EQ(argparser_add_argument(variables, &jobs, { .long_flag = "jobs" }), 0);
+	ASSERT_EQ(argparser_add_field(variables, struct record_command, retries, { .long_flag = "retries" }), 1);
+	ASSERT_EQ(argparser_add_arguments(variables, &spec, 1), 0);
+	ASSERT_EQ(argparser_add_field(common, struct record_command, color, { .long_flag = "color", .action = ARGPARSER_ACTION_STORE_TRUE }), 0);
+	ASSERT_EQ(argparser_add_parent(variables, common), 1);
+	ASSERT_EQ(argparser_add_parent(records, common), 0);
+	ASSERT_EQ(argparser_add_parent(run, variables), 1);
+	argparser_destroy(records);
+	argparser_destroy(variables);
+	argparser_destroy(common);
+}
+
+TEST(argparser, defaults_are_restored_on_every_parse) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *first[] = { "-vv", "--jobs", "8", "--name", "joe", "--quiet" };
+	const char *second[] = { "-v" };
+	int verbosity;
+	int jobs;
+	char *name;
+	bool quiet;
+	struct record_options record = { .level = 7 };
+	argparser_t argparser;
+	argparser_t record_parser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_count(argparser, &verbosity, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument(argparser, &jobs, { .long_flag = "jobs", .default_value = (void **)&(int){ 4 } });
+	argparser_add_argument(argparser, &name, { .long_flag = "name", .default_value = (void **)"anonymous" });
+	argparser_add_argument_action_store_true(argparser, &quiet, (struct argparser_argument){ .long_flag = "quiet" });
+	ASSERT_EQ(argparser_parse_args(argparser, first, 6), 0);
+	ASSERT_EQ(verbosity == 2 && jobs == 8 && quiet, true);
+	ASSERT_EQ(argparser_parse_args(argparser, second, 1), 0);
+	ASSERT_EQ(verbosity == 1 && jobs == 4 && !quiet, true);
+	ASSERT_EQ(strcmp(name, "anonymous"), 0);
+	argparser_destroy(argparser);
+	record_parser = argparser_init(argc, argv);
+	argparser_add_field(record_parser, struct record_options, level, { .long_flag = "level", .default_value = (void **)&(int){ 2 } });
+	argparser_add_field(record_parser, struct record_options, name, { .long_flag = "name" });
+	ASSERT_EQ(argparser_parse_record(record_parser, second, 0, &record), 0);
+	argparser_destroy(record_parser);
+	ASSERT_EQ(record.level == 2 && record.name == nullptr, true);
+}
+
+TEST(argparser, add_arguments_registers_specs_at_once) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *args[] = { "-vv", "--jobs", "8", "--dry-run", "a", "b" };
+	int verbosity;
+	int jobs;
+	bool dry_run;
+	char **files;
+	char *name;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	const struct argparser_argument specs[] = {
+		argparser_argument_of(&verbosity, .flag = "v", .action = ARGPARSER_ACTION_COUNT),
+		argparser_argument_of(&jobs, .long_flag = "jobs"),
+		argparser_argument_of(&dry_run, .long_flag = "dry-run", .action = ARGPARSER_ACTION_STORE_TRUE),
+		argparser_argument_of(&files, .name = "files", .action_nargs = ARGPARSER_ACTION_NARGS_LIST),
+	};
+	const struct argparser_argument invalid[] = {
+		argparser_argument_of(&jobs, .flag = "q", .action = ARGPARSER_ACTION_STORE_TRUE),
+		argparser_argument_of(&files, .long_flag = "file"),
+		argparser_argument_of(&name, .long_flag = "name", .action_nargs = ARGPARSER_ACTION_NARGS_LIST),
+	};
+	const struct argparser_argument batch[] = {
+		argparser_argument_of(&jobs, .long_flag = "other"),
+		invalid[0],
+	};
+	const char *rejected[] = { "--other", "1", "-q", "--file", "f", "--name", "n" };
+	char *leftovers[8];
+	size_t leftovers_number;
+	ASSERT_EQ(argparser_reserve_arguments(argparser, 16), 0);
+	for (size_t i = 0; i < sizeof invalid / sizeof *invalid; i++) {
+		ASSERT_EQ(argparser_add_arguments(argparser, &invalid[i], 1), 1);
+	}
+	ASSERT_EQ(argparser_add_arguments(argparser, batch, 2), 1);
+	ASSERT_EQ(argparser_parse_known_args(argparser, rejected, 7, leftovers, &leftovers_number), 0);
+	ASSERT_EQ(leftovers_number, 7);
+	ASSERT_EQ(argparser_add_arguments(argparser, specs, 4), 0);
+	ASSERT_EQ(argparser_parse_args(argparser, args, 6), 0);
+	ASSERT_EQ(verbosity == 2 && jobs == 8 && dry_run, true);
+	ASSERT_EQ(strcmp(files[0], "a") == 0 && strcmp(files[1], "b") == 0 && files[2] == nullptr, true);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, parents_share_options_by_reference) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *command;
+	char *name;
+	bool verbose;
+	int jobs;
+	char *help;
+	argparser_t common;
+	argparser_t argparser;
+	argparser_t build;
+	argparser_t test;
+	common = argparser_init(argc, argv);
+	argparser_add_argument_action_store_true(common, &verbose, (struct argparser_argument){ .flag = "v" });
+	argparser_add_argument(common, &jobs, { .long_flag = "jobs", .default_value = (void **)&(int){ 1 } });
+	argparser = argparser_init(argc, argv);
+	build = argparser_add_subparser(argparser, &command, "build", nullptr);
+	test = argparser_add_subparser(argparser, &command, "test", nullptr);
+	argparser_add_argument(test, &name, { .long_flag = "name" });
+	ASSERT_EQ(argparser_add_parent(build, common), 0);
+	ASSERT_EQ(argparser_add_parent(test, common), 0);
+	ASSERT_EQ(argparser_add_argument(common, &name, { .long_flag = "late" }), 1);
+	ASSERT_EQ(argparser_add_parent(common, build), 1);
+	ASSERT_EQ(argparser_parse_args(argparser, ((const char *[]){ "build", "-v", "--jobs", "4" }), 4), 0);
+	ASSERT_EQ(strcmp(command, "build") == 0 && verbose && jobs == 4, true);
+	ASSERT_EQ(argparser_parse_args(argparser, ((const char *[]){ "test", "--name", "unit" }), 3), 0);
+	ASSERT_EQ(strcmp(command, "test") == 0 && !verbose && jobs == 1, true);
+	help = argparser_format_help(test);
+	ASSERT_EQ(strstr(help, "--jobs") != nullptr && strstr(help, "--name") != nullptr, true);
+	free(help);
+	argparser_destroy(argparser);
+	argparser_destroy(common);
+}
+
+/* Parses args in a child process and returns its exit status along with what it printed. */
+static int parse_in_child(argparser_t argparser, const char *args[], size_t args_size, char *output, size_t size) {
+	size_t length = 0;
+	ssize_t n;
+	int fds[2];
+	int status;
+	pid_t pid;
+	if (pipe(fds)) {
+		return -1;
+	}
+	pid = fork();
+	if (pid == 0) {
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		argparser_parse_args(argparser, args, args_size);
+		_exit(EXIT_SUCCESS);
+	}
+	close(fds[1]);
+	while ((n = read(fds[0], output + length, size - 1 - length)) > 0) {
+		length += (size_t)n;
+	}
+	output[length] = '\0';
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(argparser, constraint_groups_report_conflicting_flags) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	bool all;
+	bool none;
+	char *user;
+	char *password;
+	char *output;
+	bool force;
+	char printed[512];
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument_action_store_true(argparser, &all, (struct argparser_argument){ .long_flag = "all" });
+	argparser_add_argument_action_store_true(argparser, &none, (struct argparser_argument){ .long_flag = "none" });
+	argparser_add_argument(argparser, &user, { .long_flag = "user" });
+	argparser_add_argument(argparser, &password, { .long_flag = "password" });
+	argparser_add_argument(argparser, &output, { .flag = "o" });
+	argparser_add_argument_action_store_true(argparser, &force, (struct argparser_argument){ .long_flag = "force" });
+	ASSERT_EQ(argparser_add_constraint(argparser, ARGPARSER_CONSTRAINT_MUTUALLY_EXCLUSIVE, (const char *[]){ "all", "none", nullptr }), 0);
+	ASSERT_EQ(argparser_add_constraint(argparser, ARGPARSER_CONSTRAINT_REQUIRED_TOGETHER, (const char *[]){ "user", "password", nullptr }), 0);
+	ASSERT_EQ(argparser_add_constraint(argparser, ARGPARSER_CONSTRAINT_REQUIRES, (const char *[]){ "force", "o", nullptr }), 0);
+	ASSERT_EQ(argparser_add_constraint(argparser, ARGPARSER_CONSTRAINT_REQUIRES, (const char *[]){ "force", "missing", nullptr }), 1);
+	ASSERT_EQ(argparser_parse_args(argparser, ((const char *[]){ "--all", "--user", "u", "--password", "p" }), 5), 0);
+	ASSERT_EQ(argparser_get_constraint_error(argparser).constraint, ARGPARSER_CONSTRAINT_NONE);
+	ASSERT_EQ(argparser_parse_args(argparser, ((const char *[]){ "-o", "out", "--force" }), 3), 0);
+	ASSERT_EQ(parse_in_child(argparser, (const char *[]){ "--none", "--all" }, 2, printed, sizeof printed), EXIT_FAILURE);
+	ASSERT_EQ(strstr(printed, "error: argument --all: not allowed with argument --none\n") != nullptr, true);
+	ASSERT_EQ(parse_in_child(argparser, (const char *[]){ "--password", "p" }, 2, printed, sizeof printed), EXIT_FAILURE);
+	ASSERT_EQ(strstr(printed, "error: argument --password: must be given together with argument --user\n") != nullptr, true);
+	ASSERT_EQ(parse_in_child(argparser, (const char *[]){ "--force" }, 1, printed, sizeof printed), EXIT_FAILURE);
+	ASSERT_EQ(strstr(printed, "error: argument --force: requires argument -o\n") != nullptr, true);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, string_view_outside_its_choices_is_reported) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	struct argparser_string_view mode = { 0 };
+	char printed[512];
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_add_argument(argparser, &mode, { .long_flag = "mode", .choices = (char *[]){ "fast", "safe", nullptr } });
+	ASSERT_EQ(parse_in_child(argparser, (const char *[]){ "--mode=fats" }, 1, printed, sizeof printed), EXIT_FAILURE);
+	ASSERT_EQ(strstr(printed, "argument --mode: invalid choice: 'fats' (choose from 'fast','safe')") != nullptr, true);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, subparsers_share_one_pool) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	static char names[1000][8];
+	const char *command;
+	char *target;
+	argparser_t argparser;
+	argparser_t subparser;
+	argparser = argparser_init(argc, argv);
+	argparser_enable_stats(argparser);
+	for (size_t i = 0; i < 1000; i++) {
+		snprintf(names[i], sizeof names[i], "c%zu", i);
+		subparser = argparser_add_subparser(argparser, &command, names[i], nullptr);
+	}
+	ASSERT_EQ(argparser_get_stats(argparser).allocations < 50, true);
+	ASSERT_EQ(strcmp(argparser_get_program_name(subparser), "test_program c999"), 0);
+	argparser_add_argument(subparser, &target, { .name = "target" });
+	ASSERT_EQ(argparser_parse_args(argparser, ((const char *[]){ "c999", "all" }), 2), 0);
+	ASSERT_EQ(strcmp(command, "c999") == 0 && strcmp(target, "all") == 0, true);
+	argparser_destroy(argparser);
+}
+
+TEST(argparser, help_references_resolve_from_catalog) {
+	char *argv[] = { "./test_program" };
+	int argc = sizeof argv / sizeof *argv;
+	const char *catalog_path = "test_argparser_help.catalog";
+	FILE *catalog_file;
+	bool verbose;
+	char *target;
+	char *help_message;
+	bool result = true;
+	argparser_t argparser;
+	argparser = argparser_init(argc, argv);
+	argparser_set_description(argparser, argparser_help_key("program"));
+	argparser_add_argument_action_store_true(argparser,
+	                                         &verbose,
+	                                         (struct argparser_argument){ .long_flag = "verbose",
+	                                                                      .help = argparser_help_key("verbose") });
+	argparser_add_argument(argparser, &target, { .name = "target", .help = argparser_help_key("target") });
+	argparser_set_help_catalog(argparser, catalog_path);
+	// The catalog is only opened by the help, it does not exist while parsing.
+	result &= (argparser_parse_args(argparser, ((char *[]){ "--verbose", "all" })) == 0);
+	catalog_file = fopen(catalog_path, "w");
+	fputs("# help of test_program\n"
+	      "verbose = print more information\n"
+	      "program = An example program.\n",
+	      catalog_file);
+	fclose(catalog_file);
+	help_message = argparser_format_help(argparser);
+	result &= strstr(help_message, "An example program.\n") != nullptr;
+	result &= strstr(help_message, "print more information") != nullptr;
+	result &= strstr(help_message, "target\t\t\ttarget") != nullptr;
+	free(help_message);
+	argparser_destroy(argparser);
+	remove(catalog_path);
+	ASSERT_EQ(result, true);
+}